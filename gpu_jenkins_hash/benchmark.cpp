@@ -0,0 +1,222 @@
+#include "benchmark.hpp"
+#include "lookup3_batch.hpp"
+#include "lookup3_incremental.hpp"
+#include "pattern.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+    struct length_profile_t {
+        const char* name;
+        uint32_t min_length;
+        uint32_t max_length;
+    };
+
+    static std::vector<uploaded_string> make_frame(size_t frameSize, length_profile_t const& profile) {
+        std::mt19937 rng(0x4A454E4B);
+        std::uniform_int_distribution<uint32_t> length(profile.min_length, profile.max_length);
+        std::uniform_int_distribution<int> character('A', 'Z');
+
+        std::vector<uploaded_string> frame(frameSize);
+        std::string value;
+        for (uploaded_string& element : frame) {
+            value.resize(length(rng));
+            for (char& c : value)
+                c = char(character(rng));
+
+            element = value;
+        }
+
+        return frame;
+    }
+
+    void hash_kernels(size_t frameSize, uint32_t iterations) {
+        const length_profile_t profiles[] = {
+            { "fixed, 30 bytes", 30, 30 },
+            { "mixed, 8-64 bytes", 8, 64 },
+            { "long, 96-128 bytes", 96, 128 },
+        };
+
+        const lookup3_kernel kernels[] = {
+            lookup3_kernel::scalar,
+            lookup3_kernel::avx2,
+            lookup3_kernel::avx512,
+        };
+
+        std::cout << ">> Benchmarking batch kernels (" << frameSize << " strings per frame, "
+            << iterations << " iterations)" << std::endl;
+
+        for (length_profile_t const& profile : profiles) {
+            std::vector<uploaded_string> frame = make_frame(frameSize, profile);
+
+            std::cout << "\n   " << profile.name << std::endl;
+
+            double scalarRate = 0.0;
+            for (lookup3_kernel kernel : kernels) {
+                std::cout << "      " << std::left << std::setw(20) << to_string(kernel);
+                if (!hashlittle_batch_supported(kernel)) {
+                    std::cout << "not supported" << std::endl;
+                    continue;
+                }
+
+                // Warm up caches and let the core settle on a frequency for this ISA.
+                hashlittle_batch(frame.data(), frame.size(), kernel);
+
+                auto start = std::chrono::high_resolution_clock::now();
+                for (uint32_t i = 0; i < iterations; ++i)
+                    hashlittle_batch(frame.data(), frame.size(), kernel);
+                auto end = std::chrono::high_resolution_clock::now();
+
+                double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1.0e9;
+                double rate = (double(frameSize) * iterations) / seconds;
+                if (kernel == lookup3_kernel::scalar)
+                    scalarRate = rate;
+
+                // Results must not depend on the kernel.
+                size_t wrong = 0;
+                for (uploaded_string const& element : frame)
+                    if (element.get_hash() != element.get_cpu_hash())
+                        ++wrong;
+
+                std::cout << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (rate / 1.0e6) << " MH/s"
+                    << "  x" << std::setprecision(2) << (rate / scalarRate);
+                if (wrong != 0)
+                    std::cout << "  (" << wrong << " WRONG)";
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    // Runs f over every value of pattern; returns the rate in values per second. If wrong is
+    // provided, it receives the number of values whose hash does not match hashlittle().
+    template <typename F>
+    static double enumerate(std::string_view pattern, F f, size_t* wrong = nullptr) {
+        pattern_t p(pattern);
+        uploaded_string element;
+
+        size_t count = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        while (f(p, element)) {
+            if (wrong != nullptr && element.get_hash() != element.get_cpu_hash())
+                ++*wrong;
+            ++count;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1.0e9;
+        return count / seconds;
+    }
+
+    void enumeration() {
+        const char* patterns[] = {
+            "WORLD/MAPS/AZEROTH/AZEROTH_[0-9]{2}_[0-9]{2}.ADT",
+            "INTERFACE/ICONS/INV_MISC_[a-z]{4}.BLP",
+            "SOUND/CREATURE/[a-z]{2}/[a-z]{3}_ATTACK.OGG",
+        };
+
+        std::cout << "\n>> Benchmarking pattern enumeration" << std::endl;
+
+        for (const char* pattern : patterns) {
+            std::cout << "\n   " << pattern << std::endl;
+
+            double fullRate = enumerate(pattern, [](pattern_t& p, uploaded_string& element) {
+                if (!p.write(element))
+                    return false;
+
+                element.set_hash(element.get_cpu_hash());
+                return true;
+            });
+
+            std::cout << "      " << std::left << std::setw(20) << "full"
+                << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (fullRate / 1.0e6) << " MH/s" << std::endl;
+
+            lookup3_incremental hasher;
+            auto incremental = [&hasher](pattern_t& p, uploaded_string& element) {
+                return p.write(element, hasher);
+            };
+            double incrementalRate = enumerate(pattern, incremental);
+
+            // Results must not depend on the way they were computed.
+            size_t wrong = 0;
+            hasher.reset();
+            enumerate(pattern, incremental, &wrong);
+
+            std::cout << "      " << std::left << std::setw(20) << "incremental"
+                << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (incrementalRate / 1.0e6) << " MH/s"
+                << "  x" << std::setprecision(2) << (incrementalRate / fullRate);
+            if (wrong != 0)
+                std::cout << "  (" << wrong << " WRONG)";
+            std::cout << std::endl;
+        }
+    }
+
+    // Fills frames from pattern with fill until a few million values were written, starting over
+    // whenever the pattern runs out; returns the rate in values per second.
+    template <typename F>
+    static double fill_frames(std::string_view pattern, size_t frameSize, F fill) {
+        constexpr const uint64_t valueCount = 1u << 23;
+
+        pattern_t p(pattern);
+        std::vector<uploaded_string> frame(frameSize);
+
+        uint64_t count = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        while (count < valueCount) {
+            size_t written = fill(p, frame);
+            if (written == 0)
+                p.seek(0);
+
+            count += written;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1.0e9;
+        return count / seconds;
+    }
+
+    void generators(size_t frameSize) {
+        struct shape_t {
+            const char* name;
+            const char* pattern;
+        };
+
+        const shape_t shapes[] = {
+            { "prefix, run, suffix", "INTERFACE/ICONS/INV_MISC_[a-z]{4}.BLP" },
+            { "prefix, run", "WORLD/MINIMAPS/MAP[0-9]{6}" },
+            { "run only", "[hex]{6}" },
+            { "prefix, alternation", "SOUND/CREATURE/(ATTACK|WOUND|DEATH|AGGRO|STAND|SPELL|READY|WALK).OGG" },
+        };
+
+        std::cout << "\n>> Benchmarking pattern generators (" << frameSize << " strings per frame)" << std::endl;
+
+        for (shape_t const& shape : shapes) {
+            std::cout << "\n   " << shape.name << ": " << shape.pattern << std::endl;
+
+            double genericRate = fill_frames(shape.pattern, frameSize, [](pattern_t& p, std::vector<uploaded_string>& frame) {
+                size_t i = 0;
+                for (; i < frame.size(); ++i)
+                    if (!p.write(frame[i]))
+                        break;
+
+                return i;
+            });
+
+            double specializedRate = fill_frames(shape.pattern, frameSize, [](pattern_t& p, std::vector<uploaded_string>& frame) {
+                return p.write(frame.data(), frame.size());
+            });
+
+            std::cout << "      " << std::left << std::setw(20) << "generic"
+                << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (genericRate / 1.0e6) << " M/s" << std::endl;
+            std::cout << "      " << std::left << std::setw(20) << "specialized"
+                << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (specializedRate / 1.0e6) << " M/s"
+                << "  x" << std::setprecision(2) << (specializedRate / genericRate) << std::endl;
+        }
+    }
+}
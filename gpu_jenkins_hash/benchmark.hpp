@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace benchmark {
+    // Times every batch hash kernel supported by this CPU on synthetic frames of frameSize
+    // records, for a few length profiles, and prints the hash rate of each.
+    void hash_kernels(size_t frameSize, uint32_t iterations);
+
+    // Enumerates a few patterns, hashing every value from scratch and then incrementally, and
+    // prints the rate of both.
+    void enumeration();
+
+    // Fills frames of frameSize strings from patterns of each shape pattern_generators specializes,
+    // value by value through the generic odometer and then with the specialized generator, and
+    // prints the rate of both.
+    void generators(size_t frameSize);
+}
@@ -63,10 +63,16 @@ struct buffer_t
 
     /// Updates the buffer regarding its descriptor set.
     void update(VkDevice device)
+    {
+        update(device, set);
+    }
+
+    /// Binds the buffer to its binding index in the provided descriptor set.
+    void update(VkDevice device, VkDescriptorSet dstSet)
     {
         VkWriteDescriptorSet writeDescriptorSet{};
         writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSet.dstSet = set;
+        writeDescriptorSet.dstSet = dstSet;
         writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         writeDescriptorSet.descriptorCount = 1;
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+// Arithmetic on numbers of values, which throws error instead of wrapping around.
+
+inline uint64_t checked_add(uint64_t lhs, uint64_t rhs, const char* error = "Pattern has too many values") {
+    if (rhs > std::numeric_limits<uint64_t>::max() - lhs)
+        throw std::runtime_error(error);
+
+    return lhs + rhs;
+}
+
+inline uint64_t checked_multiply(uint64_t lhs, uint64_t rhs, const char* error = "Pattern has too many values") {
+    if (lhs != 0 && rhs > std::numeric_limits<uint64_t>::max() / lhs)
+        throw std::runtime_error(error);
+
+    return lhs * rhs;
+}
@@ -0,0 +1,162 @@
+#include "checkpoint.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    std::string to_string(input_position const& position) {
+        return std::to_string(position.pattern) + ":" + std::to_string(position.index);
+    }
+
+    input_position parse_position(std::string_view value) {
+        size_t separator = value.find(':');
+        if (separator == std::string_view::npos)
+            throw std::runtime_error("Invalid position '" + std::string(value) + "' in checkpoint");
+
+        return input_position{
+            std::stoull(std::string(value.substr(0, separator))),
+            std::stoull(std::string(value.substr(separator + 1)))
+        };
+    }
+}
+
+void checkpoint_t::save(std::string const& path) const
+{
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream fs(temporary, std::ios::trunc);
+        if (!fs.is_open())
+            throw std::runtime_error("Failed to write checkpoint '" + temporary + "'");
+
+        fs << "input=" << input << "\n"
+            << "deduplicated=" << (deduplicated ? 1 : 0) << "\n"
+            << "shard=" << shard << "\n"
+            << "pattern=" << position.pattern << "\n"
+            << "index=" << position.index << "\n"
+            << "hashed=" << hashed << "\n"
+            << "matches=" << matches << "\n"
+            << "hits=" << hits_offset << "\n"
+            << "in_flight=";
+
+        for (size_t i = 0; i < in_flight.size(); ++i)
+            fs << (i == 0 ? "" : ",") << to_string(in_flight[i]);
+        fs << "\n";
+
+        fs.flush();
+        if (!fs)
+            throw std::runtime_error("Failed to write checkpoint '" + temporary + "'");
+    }
+
+    std::filesystem::rename(temporary, path);
+}
+
+checkpoint_t checkpoint_t::load(std::string const& path)
+{
+    std::ifstream fs(path);
+    if (!fs.is_open())
+        throw std::runtime_error("Failed to open checkpoint '" + path + "'");
+
+    checkpoint_t checkpoint;
+    bool positioned = false;
+
+    std::string line;
+    while (std::getline(fs, line)) {
+        size_t separator = line.find('=');
+        if (separator == std::string::npos)
+            continue;
+
+        std::string_view key = std::string_view(line).substr(0, separator);
+        std::string value = line.substr(separator + 1);
+
+        if (key == "input")
+            checkpoint.input = value;
+        else if (key == "deduplicated")
+            checkpoint.deduplicated = value == "1";
+        else if (key == "shard")
+            checkpoint.shard = value;
+        else if (key == "pattern") {
+            checkpoint.position.pattern = std::stoull(value);
+            positioned = true;
+        }
+        else if (key == "index")
+            checkpoint.position.index = std::stoull(value);
+        else if (key == "hashed")
+            checkpoint.hashed = std::stoull(value);
+        else if (key == "matches")
+            checkpoint.matches = std::stoull(value);
+        else if (key == "hits")
+            checkpoint.hits_offset = std::stoull(value);
+        else if (key == "in_flight") {
+            std::string_view list = value;
+            while (!list.empty()) {
+                size_t comma = list.find(',');
+                checkpoint.in_flight.push_back(parse_position(list.substr(0, comma)));
+
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            }
+        }
+    }
+
+    if (!positioned)
+        throw std::runtime_error("Checkpoint '" + path + "' holds no position");
+
+    return checkpoint;
+}
+
+checkpoint_writer::checkpoint_writer(std::string path, checkpoint_t state, std::chrono::seconds interval)
+    : _path(std::move(path)), _state(std::move(state)), _interval(interval), _lastSave(std::chrono::steady_clock::now())
+{
+    _state.in_flight.clear();
+}
+
+void checkpoint_writer::produced(input_position const& position, size_t count)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _inFlight.push_back(frame_t{ position, count });
+}
+
+void checkpoint_writer::consumed(uint64_t matches, uint64_t hits_offset)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_inFlight.empty())
+        return;
+
+    frame_t frame = _inFlight.front();
+    _inFlight.pop_front();
+
+    _state.position = frame.end;
+    _state.hashed += frame.count;
+    _state.matches = matches;
+    _state.hits_offset = hits_offset;
+
+    // Saving costs a few file system calls; once every interval keeps it out of the hash rate.
+    auto now = std::chrono::steady_clock::now();
+    if (now - _lastSave < _interval)
+        return;
+
+    // A checkpoint that could not be written is not worth stopping the run for; the next one may be.
+    try {
+        save();
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+    }
+    _lastSave = now;
+}
+
+void checkpoint_writer::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    save();
+}
+
+void checkpoint_writer::save()
+{
+    _state.in_flight.clear();
+    for (frame_t const& frame : _inFlight)
+        _state.in_flight.push_back(frame.end);
+
+    _state.save(_path);
+}
@@ -0,0 +1,78 @@
+#include "cpu_features.hpp"
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+#else
+# include <cpuid.h>
+#endif
+
+namespace cpu_features {
+    struct registers_t {
+        uint32_t eax = 0;
+        uint32_t ebx = 0;
+        uint32_t ecx = 0;
+        uint32_t edx = 0;
+    };
+
+    static registers_t cpuid(uint32_t leaf, uint32_t subleaf = 0) {
+        registers_t r;
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuidex(regs, int(leaf), int(subleaf));
+        r.eax = uint32_t(regs[0]);
+        r.ebx = uint32_t(regs[1]);
+        r.ecx = uint32_t(regs[2]);
+        r.edx = uint32_t(regs[3]);
+#else
+        __cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+        return r;
+    }
+
+    // XCR0, the set of register states the OS saves on context switches.
+    static uint64_t xgetbv() {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (uint64_t(edx) << 32) | eax;
+#endif
+    }
+
+    static bool os_saves(uint64_t states) {
+        registers_t leaf1 = cpuid(1);
+
+        // OSXSAVE and AVX
+        if ((leaf1.ecx & (1u << 27)) == 0 || (leaf1.ecx & (1u << 28)) == 0)
+            return false;
+
+        return (xgetbv() & states) == states;
+    }
+
+    bool avx2() {
+        static const bool supported = [] {
+            // XMM and YMM state
+            if (cpuid(0).eax < 7 || !os_saves(0x6))
+                return false;
+
+            return (cpuid(7).ebx & (1u << 5)) != 0;
+        }();
+
+        return supported;
+    }
+
+    bool avx512() {
+        static const bool supported = [] {
+            // XMM, YMM, opmask, upper halves of ZMM0-15 and ZMM16-31
+            if (cpuid(0).eax < 7 || !os_saves(0xE6))
+                return false;
+
+            return (cpuid(7).ebx & (1u << 16)) != 0;
+        }();
+
+        return supported;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Instruction sets the CPU backend can dispatch to at runtime.
+// Kernels are compiled for their target instruction set regardless of the global compiler
+// flags; callers must check the matching predicate before calling into them.
+
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC accepts any intrinsic in any function.
+# define CPU_TARGET_AVX2
+# define CPU_TARGET_AVX512
+#else
+# define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+# define CPU_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace cpu_features {
+    // AVX2 is supported by both the CPU and the OS (YMM state is saved on context switches).
+    bool avx2();
+
+    // AVX-512 Foundation is supported by both the CPU and the OS (ZMM and opmask state is saved).
+    bool avx512();
+}
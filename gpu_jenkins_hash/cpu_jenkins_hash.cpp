@@ -0,0 +1,237 @@
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "cpu_jenkins_hash.hpp"
+#include "metrics.hpp"
+#include "lookup3_batch.hpp"
+
+// Smallest slice of a frame worth waking a worker up for.
+constexpr const size_t minimumJobSize = 256;
+
+JenkinsCpuHash::JenkinsCpuHash(size_t frameCount, size_t threadCount, size_t frameSize)
+    : _threadCount(std::max<size_t>(threadCount, 1)), _frameSize(std::max<size_t>(frameSize, 1))
+{
+    _frames.resize(std::max<size_t>(frameCount, 1));
+}
+
+JenkinsCpuHash::~JenkinsCpuHash()
+{
+    cleanup();
+}
+
+void JenkinsCpuHash::run()
+{
+    for (Frame& frame : _frames) {
+        if (isPacked()) {
+            const size_t arenaBytes = _frameSize * packed_strings::default_bytes_per_string;
+
+            frame.packedStorage.resize(packed_strings::required_words(_frameSize, arenaBytes));
+            frame.packed = packed_strings(frame.packedStorage.data(), _frameSize, arenaBytes);
+        }
+        else
+            frame.data.resize(_frameSize);
+    }
+
+    createWorkers();
+
+    mainLoop();
+}
+
+void JenkinsCpuHash::createWorkers()
+{
+    _exiting = false;
+
+    for (size_t i = 0; i < _threadCount; ++i)
+        _workers.emplace_back(&JenkinsCpuHash::workerLoop, this);
+}
+
+void JenkinsCpuHash::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _exiting = true;
+    }
+    _jobAvailable.notify_all();
+
+    for (std::thread& worker : _workers)
+        if (worker.joinable())
+            worker.join();
+
+    _workers.clear();
+}
+
+void JenkinsCpuHash::workerLoop()
+{
+    lookup3_run_seeder seeder;
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobAvailable.wait(lock, [this]() { return _exiting || !_jobs.empty(); });
+
+            if (_jobs.empty())
+                return;
+
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        if (isPacked())
+            hashlittle_packed(job.frame->packed, job.begin, job.end);
+        else if (_runProvider) {
+            seeder.reset(job.frame->runs);
+            hashlittle_batch(job.frame->data.data() + job.begin, job.end - job.begin, lookup3_seeds(&seeder, job.begin));
+        }
+        else
+            hashlittle_batch(job.frame->data.data() + job.begin, job.end - job.begin, job.prefix);
+
+        bool signaled = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            signaled = --job.frame->pending == 0;
+        }
+
+        if (signaled)
+            _frameDone.notify_all();
+    }
+}
+
+void JenkinsCpuHash::mainLoop()
+{
+    try {
+        metrics::start();
+
+        std::cout << ">> Hashing ..." << std::endl;
+
+        // Unlike the GPU, there is no need to prime the ring separately: a frame that was never
+        // submitted has no output, so the steady state loop handles the first iterations as well.
+        while (true) {
+            beginFrame();
+
+            Frame& currentFrame = _frames[_currentFrame];
+
+            // Handle previous output
+            if (currentFrame.item_count != 0)
+                handleOutput(currentFrame);
+
+            // Write new input
+            currentFrame.item_count = provideData(currentFrame);
+
+            // Nothing left to process?
+            if (currentFrame.item_count == 0)
+                break;
+
+            metrics::increment(currentFrame.item_count);
+
+            submitFrame();
+        }
+
+        std::cout << ">> Finalizing ..." << std::endl;
+
+        // Collect whatever is still in flight, oldest frame first.
+        for (size_t i = 0; i < _frames.size(); ++i) {
+            _currentFrame = (_currentFrame + 1) % _frames.size();
+
+            beginFrame();
+
+            Frame& frame = _frames[_currentFrame];
+            if (frame.item_count == 0)
+                continue;
+
+            handleOutput(frame);
+            frame.item_count = 0;
+        }
+
+        metrics::stop();
+
+        std::cout << ">> Done!" << std::endl;
+    }
+    catch (...) {
+        // Workers finish the jobs already queued before they exit.
+        cleanup();
+        throw;
+    }
+
+    cleanup();
+}
+
+size_t JenkinsCpuHash::provideData(Frame& frame)
+{
+    if (!isPacked())
+        return _dataProvider(frame.data.data(), _frameSize);
+
+    frame.packed.clear();
+    return _packedDataProvider(frame.packed);
+}
+
+void JenkinsCpuHash::handleOutput(Frame& frame)
+{
+    if (isPacked())
+        _packedOutputHandler(frame.packed);
+    else
+        _outputHandler(frame.data.data(), frame.item_count);
+}
+
+void JenkinsCpuHash::beginFrame()
+{
+    Frame& frame = _frames[_currentFrame];
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _frameDone.wait(lock, [&frame]() { return frame.pending == 0; });
+}
+
+void JenkinsCpuHash::submitJobs(Frame& frame, size_t begin, size_t end, const lookup3_prefix* prefix)
+{
+    size_t jobSize = std::max(minimumJobSize, (end - begin + _threadCount - 1) / _threadCount);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (; begin < end; begin += jobSize) {
+        _jobs.push_back(Job{ &frame, begin, std::min(end, begin + jobSize), prefix });
+        ++frame.pending;
+    }
+}
+
+void JenkinsCpuHash::submitFrame()
+{
+    Frame& frame = _frames[_currentFrame];
+
+    if (_prehashed) {
+        _currentFrame = (_currentFrame + 1) % _frames.size();
+        return;
+    }
+
+    if (_runProvider && !isPacked()) {
+        _runProvider(frame.runs);
+
+        submitJobs(frame, 0, frame.item_count, nullptr);
+        _jobAvailable.notify_all();
+
+        _currentFrame = (_currentFrame + 1) % _frames.size();
+        return;
+    }
+
+    // Midstates only need to be recomputed when the pattern changes.
+    frame.prefix_begin = frame.item_count;
+    if (_prefixProvider && !isPacked()) {
+        std::string_view prefix;
+        size_t shared = std::min(_prefixProvider(prefix), frame.item_count);
+
+        if (!_prefix || _prefix->value() != prefix)
+            _prefix = std::make_shared<const lookup3_prefix>(prefix);
+
+        frame.prefix_begin = frame.item_count - shared;
+    }
+    frame.prefix = _prefix;
+
+    submitJobs(frame, 0, frame.prefix_begin, nullptr);
+    submitJobs(frame, frame.prefix_begin, frame.item_count, frame.prefix.get());
+
+    _jobAvailable.notify_all();
+
+    _currentFrame = (_currentFrame + 1);
+    if (_currentFrame == _frames.size()) {
+        _currentFrame = 0;
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "uploaded_string.hpp"
+#include "packed_strings.hpp"
+#include "lookup3_batch.hpp"
+
+// CPU counterpart of JenkinsGpuHash.
+// Frames are handed to a pool of worker threads instead of a compute queue; the data provider and
+// output handler contracts are exactly the same, so main() can drive either backend.
+class JenkinsCpuHash {
+public:
+    JenkinsCpuHash(size_t frameCount, size_t threadCount, size_t frameSize);
+    ~JenkinsCpuHash();
+
+    JenkinsCpuHash(JenkinsCpuHash const&) = delete;
+    JenkinsCpuHash& operator = (JenkinsCpuHash const&) = delete;
+
+    void run();
+
+    template <typename F>
+    inline void setDataProvider(F f) {
+        _dataProvider = std::function<size_t(uploaded_string*, size_t)>(std::move(f));
+    }
+
+    template <typename F>
+    inline void setOutputHandler(F f) {
+        _outputHandler = std::function<void(uploaded_string*, size_t)>(std::move(f));
+    }
+
+    // Alternatives to the two above: frames are then packed_strings batches instead of arrays of
+    // uploaded_string. Must be set together, before run().
+    template <typename F>
+    inline void setPackedDataProvider(F f) {
+        _packedDataProvider = std::function<size_t(packed_strings&)>(std::move(f));
+    }
+
+    template <typename F>
+    inline void setPackedOutputHandler(F f) {
+        _packedOutputHandler = std::function<void(packed_strings const&)>(std::move(f));
+    }
+
+    // Optional. Queried once per frame, after the data provider ran; stores the constant prefix of
+    // the pattern being enumerated, and returns how many strings at the end of the frame are known
+    // to start with it. Those resume hashing from its precomputed midstates.
+    template <typename F>
+    inline void setPrefixProvider(F f) {
+        _prefixProvider = std::function<size_t(std::string_view&)>(std::move(f));
+    }
+
+    // Optional, takes precedence over the prefix provider. Queried once per frame, after the data
+    // provider ran; stores in its argument the runs of strings of the frame that share a prefix, in
+    // order and covering the whole frame. Runs long enough to be worth it resume hashing from the
+    // midstates of their own prefix, such as every file of a directory in '{dirs}/{files}'; see
+    // lookup3_run_seeder.
+    template <typename F>
+    inline void setRunProvider(F f) {
+        _runProvider = std::function<void(std::vector<prefix_run>&)>(std::move(f));
+    }
+
+    // When set, the data provider hashes the strings itself (see lookup3_incremental); frames are
+    // then passed on to the output handler without going through the workers.
+    void setPrehashed(bool prehashed) { _prehashed = prehashed; }
+
+    size_t getFrameCount() const { return _frames.size(); }
+    size_t getThreadCount() const { return _threadCount; }
+    size_t getFrameSize() const { return _frameSize; }
+
+    void cleanup();
+
+private:
+    std::function<size_t(uploaded_string*, size_t)> _dataProvider;
+    std::function<void(uploaded_string*, size_t)> _outputHandler;
+    std::function<size_t(std::string_view&)> _prefixProvider;
+    std::function<void(std::vector<prefix_run>&)> _runProvider;
+    std::function<size_t(packed_strings&)> _packedDataProvider;
+    std::function<void(packed_strings const&)> _packedOutputHandler;
+
+    // Midstates of the last prefix seen; shared with the frames still using it.
+    std::shared_ptr<const lookup3_prefix> _prefix;
+
+    bool _prehashed = false;
+
+    size_t _threadCount = 0;
+    size_t _frameSize = 0;
+
+    size_t _currentFrame = 0u;
+
+    struct Frame {
+        std::vector<uploaded_string> data;
+
+        // Used instead of data with the packed providers.
+        std::vector<uint32_t> packedStorage;
+        packed_strings packed;
+
+        // actual number of elements written by the data provider
+        size_t item_count = 0;
+
+        // Strings from prefix_begin onward start with prefix.
+        std::shared_ptr<const lookup3_prefix> prefix;
+        size_t prefix_begin = 0;
+
+        // Runs of strings that share a prefix, with a run provider.
+        std::vector<prefix_run> runs;
+
+        // Number of chunks still being hashed by the workers; the frame is
+        // signaled (in the VkFence sense) when this drops back to zero.
+        size_t pending = 0;
+    };
+
+    // A slice of a frame handed to a worker.
+    struct Job {
+        Frame* frame;
+        size_t begin;
+        size_t end;
+        const lookup3_prefix* prefix;
+    };
+
+    std::vector<Frame> _frames;
+
+    std::vector<std::thread> _workers;
+    std::deque<Job> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _jobAvailable;
+    std::condition_variable _frameDone;
+    bool _exiting = false;
+
+    void mainLoop();
+
+    bool isPacked() const { return static_cast<bool>(_packedDataProvider); }
+
+    size_t provideData(Frame& frame);
+    void handleOutput(Frame& frame);
+
+    void createWorkers();
+
+    void workerLoop();
+
+    void beginFrame();
+    void submitFrame();
+    void submitJobs(Frame& frame, size_t begin, size_t end, const lookup3_prefix* prefix);
+};
@@ -1,17 +1,25 @@
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <cstdint>
 #include <optional>
 #include <fstream>
 #include <set>
+#include <exception>
 #include <stdexcept>
 #include <vector>
 #include <array>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 #include "gpu_jenkins_hash.hpp"
+#include "spsc_ring.hpp"
 #include "renderdoc.hpp"
 #include "metrics.hpp"
+#include "target_set.hpp"
+#include "lookup3.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -28,6 +36,14 @@ constexpr const bool enableValidationLayers = true;
 #endif
 
 
+// Number of matches a frame can report when filtering on the device. Matches are rare; if a frame
+// ever has more, the host hashes that frame again by itself.
+constexpr const uint32_t maxHitsPerFrame = 4096;
+constexpr const size_t hitBufferSize = sizeof(uint32_t) * (2 + 2 * maxHitsPerFrame);
+
+// Size of the buffer holding the base index and pattern descriptor when generating on the device.
+constexpr const size_t maxGeneratorSize = (4 + pattern_descriptor::max_words) * sizeof(uint32_t);
+
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
     if (func != nullptr) {
@@ -47,9 +63,27 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 
 void JenkinsGpuHash::run()
 {
+    if (isGenerating()) {
+        if (_targets == nullptr)
+            throw std::runtime_error("Candidates can only be generated on the device when filtering against targets");
+
+        if (!_device.features.shaderInt64)
+            throw std::runtime_error("The device does not support 64-bit integers in shaders, which generating candidates requires");
+    }
+
     createCommandPool();
     createBuffers();
 
+    if (isPacked() && _targets != nullptr) {
+        const size_t arenaBytes = maxHitsPerFrame * uploaded_string::max_length;
+
+        _packedMatchStorage.resize(packed_strings::required_words(maxHitsPerFrame, arenaBytes));
+        _packedMatches = packed_strings(_packedMatchStorage.data(), maxHitsPerFrame, arenaBytes);
+    }
+
+    if (_targets != nullptr)
+        uploadTargets();
+
     createComputePipeline();
     createSyncObjects();
 
@@ -65,28 +99,89 @@ void JenkinsGpuHash::run()
 
 void JenkinsGpuHash::createBuffers()
 {
+    // Packed batches are sized in words rather than in records; see packed_strings.
+    size_t inputSize = params.getCompleteDataSize() * sizeof(uploaded_string);
+    size_t outputSize = inputSize;
+    if (isPacked()) {
+        inputSize = packed_strings::required_words(params.getCompleteDataSize(), packedArenaSize()) * sizeof(uint32_t);
+        outputSize = packed_strings::required_words(params.getCompleteDataSize(), 0) * sizeof(uint32_t);
+    }
+    else if (isGenerating())
+        inputSize = sizeof(uploaded_string);
+
     for (Frame& frame : _frames) {
-        // Input staging buffer
+        // Input staging buffer; only used to upload the dispatch arguments when generating.
         frame.hostInputBuffer.create(_device.allocator,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             VMA_MEMORY_USAGE_CPU_TO_GPU,
-            params.getCompleteDataSize() * frame.hostInputBuffer.item_size);
+            inputSize);
+
+        if (_targets == nullptr) {
+            frame.hostOutputBuffer.create(_device.allocator,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VMA_MEMORY_USAGE_GPU_TO_CPU,
+                outputSize);
+
+            frame.hostOutputBuffer.map(_device.allocator);
+        }
+        else {
+            frame.deviceHitBuffer.create(_device.allocator,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VMA_MEMORY_USAGE_GPU_ONLY,
+                hitBufferSize);
+
+            frame.hostHitBuffer.create(_device.allocator,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VMA_MEMORY_USAGE_GPU_TO_CPU,
+                hitBufferSize);
+
+            // Hit buffer on binding 2
+            frame.deviceHitBuffer.binding = 2;
+
+            frame.hostHitBuffer.map(_device.allocator);
+        }
+
+        if (isGenerating()) {
+            // Small enough to be read by the shader straight from host memory.
+            frame.generatorBuffer.create(_device.allocator,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VMA_MEMORY_USAGE_CPU_TO_GPU,
+                maxGeneratorSize);
+
+            // Generator on binding 0
+            frame.generatorBuffer.binding = 0;
 
-        frame.hostOutputBuffer.create(_device.allocator,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VMA_MEMORY_USAGE_GPU_TO_CPU,
-            params.getCompleteDataSize() * frame.hostOutputBuffer.item_size);
+            frame.generatorBuffer.map(_device.allocator);
+        }
+        else {
+            frame.deviceBuffer.create(_device.allocator,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VMA_MEMORY_USAGE_GPU_ONLY,
+                inputSize);
+
+            // Input buffer on binding 0
+            frame.deviceBuffer.binding = 0;
+        }
 
-        frame.deviceBuffer.create(_device.allocator,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VMA_MEMORY_USAGE_GPU_ONLY,
-            params.getCompleteDataSize() * frame.deviceBuffer.item_size);
+        if (isSeedingRuns()) {
+            frame.runStateBuffer.create(_device.allocator,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VMA_MEMORY_USAGE_CPU_TO_GPU,
+                lookup3_run_table::required_words(params.getCompleteDataSize()) * sizeof(uint32_t));
 
-        // Input buffer on binding 0
-        frame.deviceBuffer.binding = 0;
+            // Run midstates on binding 3
+            frame.runStateBuffer.binding = 3;
+
+            frame.runStateBuffer.map(_device.allocator);
+        }
 
         frame.hostInputBuffer.map(_device.allocator);
-        frame.hostOutputBuffer.map(_device.allocator);
+
+        // Providers only clear the bytes a previous value used; start from zeroed records.
+        memset(frame.hostInputBuffer.data, 0, inputSize);
+
+        if (isPacked())
+            frame.packedInput = packed_strings(reinterpret_cast<uint32_t*>(frame.hostInputBuffer.data), params.getCompleteDataSize(), packedArenaSize());
     }
 
     dispatchBuffer.create(_device.allocator,
@@ -94,11 +189,253 @@ void JenkinsGpuHash::createBuffers()
         VMA_MEMORY_USAGE_GPU_ONLY, sizeof(VkDispatchIndirectCommand));
 }
 
-void JenkinsGpuHash::mainLoop()
+void JenkinsGpuHash::uploadTargets()
+{
+    std::vector<uint32_t> packed = _targets->pack();
+
+    targetBuffer.create(_device.allocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        packed.size() * targetBuffer.item_size);
+
+    // Target set on binding 1
+    targetBuffer.binding = 1;
+
+    // The frame staging buffers are usually much smaller than the target set; use a dedicated one.
+    buffer_t<uint32_t> stagingBuffer;
+    stagingBuffer.create(_device.allocator,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU,
+        packed.size() * stagingBuffer.item_size);
+    stagingBuffer.map(_device.allocator);
+    stagingBuffer.write_raw(_device.allocator, packed.data(), packed.size() * stagingBuffer.item_size);
+
+    VkCommandBuffer uploadCmd;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(_device.device, &allocInfo, &uploadCmd);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(uploadCmd, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin recording command buffer!");
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = packed.size() * stagingBuffer.item_size;
+    vkCmdCopyBuffer(uploadCmd, stagingBuffer.buffer, targetBuffer.buffer, 1, &copyRegion);
+
+    vkEndCommandBuffer(uploadCmd);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pCommandBuffers = &uploadCmd;
+    submitInfo.commandBufferCount = 1;
+
+    VkResult result = vkQueueSubmit(_computeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result == VK_SUCCESS)
+        vkQueueWaitIdle(_computeQueue);
+
+    vkFreeCommandBuffers(_device.device, _commandPool, 1, &uploadCmd);
+    stagingBuffer.release(_device.allocator);
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to upload the target set!");
+}
+
+size_t JenkinsGpuHash::provideData(Frame& frame)
+{
+    size_t written_count = provideStrings(frame);
+
+    // Only uploaded strings can be sorted by length.
+    frame.blockCount = -1;
+    if (written_count != 0 && _blockCountProvider && !isGenerating())
+        frame.blockCount = _blockCountProvider();
+
+    return written_count;
+}
+
+size_t JenkinsGpuHash::provideStrings(Frame& frame)
+{
+    if (isPacked()) {
+        frame.packedInput.clear();
+
+        size_t written_count = _packedDataProvider(frame.packedInput);
+        frame.hostInputBuffer.item_count = written_count;
+
+        // Only flush what was actually written
+        if (written_count != 0)
+            frame.hostInputBuffer.flush(_device.allocator, frame.packedInput.used_words() * sizeof(uint32_t));
+
+        return written_count;
+    }
+
+    if (!isGenerating()) {
+        size_t written_count = _dataProvider(frame.hostInputBuffer.data, params.getCompleteDataSize());
+        frame.hostInputBuffer.item_count = written_count;
+
+        // Point the strings of runs at their midstates, in their hash field.
+        if (written_count != 0 && isSeedingRuns()) {
+            _runProvider(_runs);
+
+            size_t words = _runTable.build(frame.hostInputBuffer.data, written_count, _runs, frame.runStateBuffer.data);
+            frame.runStateBuffer.flush(_device.allocator, words * sizeof(uint32_t));
+        }
+
+        // Flush memory to the device
+        if (written_count != 0)
+            frame.hostInputBuffer.flush(_device.allocator);
+
+        return written_count;
+    }
+
+    std::shared_ptr<const pattern_descriptor> descriptor = frame.descriptor;
+    uint64_t base = 0;
+
+    size_t count = _generatorProvider(descriptor, base, params.getCompleteDataSize());
+    frame.hostInputBuffer.item_count = count;
+    if (count == 0)
+        return 0;
+
+    uint32_t* words = frame.generatorBuffer.data;
+    words[0] = uint32_t(base);
+    words[1] = uint32_t(base >> 32);
+    words[2] = uint32_t(count);
+    words[3] = 0;
+
+    size_t size = 4 * sizeof(uint32_t);
+
+    // The descriptor only needs to be written again when the pattern changes.
+    if (descriptor != frame.descriptor) {
+        std::vector<uint32_t> const& descriptorWords = descriptor->words();
+        if (size + descriptorWords.size() * sizeof(uint32_t) > maxGeneratorSize)
+            throw std::runtime_error("Pattern '" + descriptor->pattern() + "' is too large to be generated on the device");
+
+        memcpy(words + 4, descriptorWords.data(), descriptorWords.size() * sizeof(uint32_t));
+        size += descriptorWords.size() * sizeof(uint32_t);
+
+        frame.descriptor = std::move(descriptor);
+    }
+    frame.base = base;
+
+    frame.generatorBuffer.flush(_device.allocator, size);
+    return count;
+}
+
+void JenkinsGpuHash::handleOutput(Frame& frame)
 {
-    auto provide_data = [this](uploaded_string* data) -> size_t {
-        return this->_dataProvider(data, this->params.getCompleteDataSize());
+    if (isPacked()) {
+        handlePackedOutput(frame);
+        return;
+    }
+
+    if (_targets == nullptr) {
+        frame.hostOutputBuffer.invalidate(_device.allocator);
+        _outputHandler(frame.hostOutputBuffer.data, frame.hostInputBuffer.item_count);
+        return;
+    }
+
+    frame.hostHitBuffer.invalidate(_device.allocator);
+
+    const uint32_t* hits = frame.hostHitBuffer.data;
+    uint32_t hitCount = hits[0];
+
+    // Only the index of matches was read back; the strings themselves are either still in the
+    // staging buffer or, when generating, built again from the descriptor.
+    uploaded_string generated;
+    auto candidate = [&](size_t index) -> uploaded_string const& {
+        if (!isGenerating())
+            return frame.hostInputBuffer.data[index];
+
+        frame.descriptor->write_at(frame.base + index, generated);
+        return generated;
     };
+
+    _matches.clear();
+    if (hitCount <= maxHitsPerFrame) {
+        for (uint32_t i = 0; i < hitCount; ++i) {
+            uploaded_string& match = _matches.emplace_back(candidate(hits[2 + i * 2]));
+            match.set_hash(hits[2 + i * 2 + 1]);
+        }
+    }
+    else {
+        for (size_t i = 0; i < frame.hostInputBuffer.item_count; ++i) {
+            uploaded_string const& element = candidate(i);
+
+            uint32_t hash = element.get_cpu_hash();
+            if (_targets->find(hash) == 0)
+                continue;
+
+            _matches.emplace_back(element).set_hash(hash);
+        }
+    }
+
+    _outputHandler(_matches.data(), _matches.size());
+}
+
+void JenkinsGpuHash::handlePackedOutput(Frame& frame)
+{
+    packed_strings& input = frame.packedInput;
+
+    // Only the table was read back; the strings are still in the staging buffer.
+    if (_targets == nullptr) {
+        frame.hostOutputBuffer.invalidate(_device.allocator);
+
+        const uint32_t* table = reinterpret_cast<const uint32_t*>(frame.hostOutputBuffer.data) + packed_strings::header_words;
+        for (size_t i = 0; i < input.size(); ++i)
+            input.set_hash(i, table[i * packed_strings::record_words + 2]);
+
+        _packedOutputHandler(input);
+        return;
+    }
+
+    frame.hostHitBuffer.invalidate(_device.allocator);
+
+    const uint32_t* hits = frame.hostHitBuffer.data;
+    uint32_t hitCount = hits[0];
+
+    _packedMatches.clear();
+    if (hitCount <= maxHitsPerFrame) {
+        for (uint32_t i = 0; i < hitCount; ++i) {
+            _packedMatches.push_back(input.value(hits[2 + i * 2]));
+            _packedMatches.set_hash(i, hits[2 + i * 2 + 1]);
+        }
+    }
+    else {
+        // Every string of the batch may match; make room for all of them, so that none is dropped.
+        const size_t capacity = std::max<size_t>(input.size(), maxHitsPerFrame);
+        const size_t arenaBytes = std::max<size_t>((input.used_words() - input.table_words()) * 4, maxHitsPerFrame * uploaded_string::max_length);
+        const size_t words = packed_strings::required_words(capacity, arenaBytes);
+        if (words > _packedMatchStorage.size())
+            _packedMatchStorage.resize(words);
+
+        _packedMatches = packed_strings(_packedMatchStorage.data(), capacity, arenaBytes);
+
+        for (size_t i = 0; i < input.size(); ++i) {
+            uint32_t hash = hashlittle(input.words(i), input.value(i).size(), 0);
+            if (_targets->find(hash) == 0)
+                continue;
+
+            _packedMatches.push_back(input.value(i));
+            _packedMatches.set_hash(_packedMatches.size() - 1, hash);
+        }
+    }
+
+    _packedOutputHandler(_packedMatches);
+}
+
+void JenkinsGpuHash::mainLoop()
+{
+    if (_pipelined) {
+        pipelinedLoop();
+        return;
+    }
+
     try {
         metrics::start();
 
@@ -112,8 +449,7 @@ void JenkinsGpuHash::mainLoop()
             beginFrame();
 
             // Upload data
-            size_t written_count = provide_data(currentFrame.hostInputBuffer.data);
-            currentFrame.hostInputBuffer.item_count = written_count;
+            size_t written_count = provideData(currentFrame);
 
             // Nothing left to process?
             if (written_count == 0)
@@ -122,9 +458,6 @@ void JenkinsGpuHash::mainLoop()
             // Increment metrics
             metrics::increment(written_count);
 
-            // Flush memory to the device
-            currentFrame.hostInputBuffer.flush(_device.allocator, written_count * currentFrame.hostInputBuffer.item_count);
-
             result = submitFrame();
 #if _DEBUG
             if (result != VK_SUCCESS)
@@ -142,19 +475,15 @@ void JenkinsGpuHash::mainLoop()
 			Frame& currentFrame = _frames[_currentFrame];
 
             // Handle previous output
-			currentFrame.hostOutputBuffer.invalidate(_device.allocator);
-            _outputHandler(currentFrame.hostOutputBuffer.data, currentFrame.hostInputBuffer.item_count);
+            handleOutput(currentFrame);
 
             // Write new input
-            size_t written_count = provide_data(currentFrame.hostInputBuffer.data);
-            currentFrame.hostInputBuffer.item_count = written_count;
+            size_t written_count = provideData(currentFrame);
 
             // Nothing left to process?
             if (written_count == 0)
                 break;
 
-			currentFrame.hostInputBuffer.flush(_device.allocator);
-
             metrics::increment(written_count);
 
             // execute frame
@@ -181,7 +510,7 @@ void JenkinsGpuHash::mainLoop()
                 continue;
 
             vkWaitForFences(_device.device, 1, &frame.flightFence, VK_TRUE, UINT64_MAX);
-            _outputHandler(frame.hostOutputBuffer.data, frame.hostOutputBuffer.item_count);
+            handleOutput(frame);
 
         }
 
@@ -189,13 +518,120 @@ void JenkinsGpuHash::mainLoop()
 
 		std::cout << ">> Done!" << std::endl;
     }
-    catch (std::exception const& e) {
-        std::cerr << e.what() << std::endl;
+    catch (...) {
+        // Frames may still be in flight; let them finish before the error unwinds the engine.
+        vkDeviceWaitIdle(_device.device);
+        throw;
     }
 
     vkDeviceWaitIdle(_device.device);
 }
 
+void JenkinsGpuHash::pipelinedLoop()
+{
+    // Frames go around three rings: free frames to the producer (this thread), filled frames to
+    // the submitter, and submitted frames to the consumer, which hands them back once handled.
+    // A null frame marks the end of the input; it is passed along until the consumer sees it.
+    spsc_ring<Frame*> freeFrames(_frames.size());
+    spsc_ring<Frame*> filledFrames(_frames.size());
+    spsc_ring<Frame*> submittedFrames(_frames.size());
+
+    for (Frame& frame : _frames)
+        freeFrames.try_push(&frame);
+
+    // Set by whichever thread fails first; closing the rings wakes up the others, which stop.
+    // The error is rethrown once every thread is joined and the device is idle.
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+
+        freeFrames.close();
+        filledFrames.close();
+        submittedFrames.close();
+    };
+
+    std::thread submitter([&]() {
+        try {
+            Frame* frame = nullptr;
+            while (filledFrames.pop(frame)) {
+                if (frame != nullptr) {
+                    renderdoc::begin_frame();
+
+                    vkResetFences(_device.device, 1, &frame->flightFence);
+                    if (submit(*frame) != VK_SUCCESS)
+                        throw std::runtime_error("vkQueueSubmit failed");
+
+                    renderdoc::end_frame();
+                }
+
+                submittedFrames.push(frame);
+                if (frame == nullptr)
+                    break;
+            }
+        }
+        catch (...) {
+            fail();
+        }
+    });
+
+    std::thread consumer([&]() {
+        try {
+            Frame* frame = nullptr;
+            while (submittedFrames.pop(frame) && frame != nullptr) {
+                vkWaitForFences(_device.device, 1, &frame->flightFence, VK_TRUE, UINT64_MAX);
+                handleOutput(*frame);
+
+                freeFrames.push(frame);
+            }
+        }
+        catch (...) {
+            fail();
+        }
+    });
+
+    metrics::start();
+
+    std::cout << ">> Hashing ..." << std::endl;
+
+    try {
+        Frame* frame = nullptr;
+        while (freeFrames.pop(frame)) {
+            size_t written_count = provideData(*frame);
+
+            // Nothing left to process?
+            if (written_count == 0) {
+                filledFrames.push(nullptr);
+                break;
+            }
+
+            metrics::increment(written_count);
+
+            filledFrames.push(frame);
+        }
+    }
+    catch (...) {
+        fail();
+    }
+
+    submitter.join();
+    consumer.join();
+
+    metrics::stop();
+
+    vkDeviceWaitIdle(_device.device);
+
+    if (error)
+        std::rethrow_exception(error);
+
+    std::cout << ">> Done!" << std::endl;
+}
+
 VkShaderModule JenkinsGpuHash::createShaderModule(const std::vector<char>& code)
 {
     VkShaderModuleCreateInfo createInfo {};
@@ -216,6 +652,7 @@ void JenkinsGpuHash::cleanup()
         frame.clear(_device.device, _device.allocator);
 
     dispatchBuffer.release(_device.allocator);
+    targetBuffer.release(_device.allocator);
 
     vkDestroyCommandPool(_device.device, _commandPool, nullptr);
 
@@ -223,6 +660,11 @@ void JenkinsGpuHash::cleanup()
     vkDestroyDescriptorPool(_device.device, _descriptor.pool, nullptr);
 
     vkDestroyPipeline(_device.device, _pipeline.pipeline, nullptr);
+    for (auto&& [blockCount, pipeline] : _blockPipelines)
+        vkDestroyPipeline(_device.device, pipeline, nullptr);
+    _blockPipelines.clear();
+
+    vkDestroyShaderModule(_device.device, _shaderModule, nullptr);
     vkDestroyPipelineLayout(_device.device, _pipeline.layout, nullptr);
 
     vmaDestroyAllocator(_device.allocator);
@@ -318,7 +760,12 @@ void JenkinsGpuHash::createLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures {};
+    vkGetPhysicalDeviceFeatures(_device.physicalDevice, &supportedFeatures);
+
+    // Generating candidates on the device needs 64-bit integers; see jenkins.comp.
     VkPhysicalDeviceFeatures deviceFeatures {};
+    deviceFeatures.shaderInt64 = supportedFeatures.shaderInt64;
 
     VkDeviceCreateInfo createInfo {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -343,6 +790,8 @@ void JenkinsGpuHash::createLogicalDevice()
         throw std::runtime_error("failed to create logical device!");
     }
 
+    _device.features = deviceFeatures;
+
     VmaAllocatorCreateInfo allocInfo{};
     allocInfo.device = _device.device;
     allocInfo.frameInUseCount = 0;
@@ -355,8 +804,18 @@ void JenkinsGpuHash::createLogicalDevice()
 
 void JenkinsGpuHash::createComputePipeline()
 {
+    // Filtering on the device also binds the target set and the hit buffer, seeding runs the
+    // midstates.
+    std::vector<uint32_t> bindings = { 0 };
+    if (_targets != nullptr)
+        bindings.insert(bindings.end(), { 1, 2 });
+    if (isSeedingRuns())
+        bindings.push_back(3);
+
+    const uint32_t bindingCount = (uint32_t)bindings.size();
+
     std::vector<VkDescriptorPoolSize> poolSizes = {
-        VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t)_frames.size() },
+        VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t)_frames.size() * bindingCount },
     };
 
     VkDescriptorPoolCreateInfo descriptorPoolInfo{};
@@ -368,9 +827,9 @@ void JenkinsGpuHash::createComputePipeline()
         throw std::runtime_error("failed to create descriptor pool");
 
     // Descriptor set bindings.
-    std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings {
-        VkDescriptorSetLayoutBinding{ 0u, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1u, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
-    };
+    std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+    for (uint32_t binding : bindings)
+        setLayoutBindings.push_back(VkDescriptorSetLayoutBinding{ binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1u, VK_SHADER_STAGE_COMPUTE_BIT, nullptr });
 
     // Create the descriptor set layout.
     VkDescriptorSetLayoutCreateInfo descriptorLayout{};
@@ -403,41 +862,22 @@ void JenkinsGpuHash::createComputePipeline()
             throw std::runtime_error("failed to create descriptor set!");
     }
 
-    auto computeShaderCode = readFile("shaders/comp.spv");
-    VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+    // All are built from jenkins.comp, see compiler.bat.
+    const char* shaderPath = "shaders/comp.spv";
+    if (isGenerating())
+        shaderPath = "shaders/generate.spv";
+    else if (isPacked())
+        shaderPath = _targets != nullptr ? "shaders/packed_filter.spv" : "shaders/packed.spv";
+    else if (isSeedingRuns())
+        shaderPath = _targets != nullptr ? "shaders/runs_filter.spv" : "shaders/runs.spv";
+    else if (_targets != nullptr)
+        shaderPath = "shaders/filter.spv";
 
-    std::vector<VkSpecializationMapEntry> specMapEntries{
-        VkSpecializationMapEntry{ 1, 0, 4 }, // Constant ID, offset, size
-        VkSpecializationMapEntry{ 2, 4, 4 }, // Constant ID, offset, size
-        VkSpecializationMapEntry{ 3, 8, 4 }, // Constant ID, offset, size
-    };
-
-    VkSpecializationInfo shaderSpecInfo{};
-    shaderSpecInfo.mapEntryCount = static_cast<uint32_t>(specMapEntries.size());
-    shaderSpecInfo.pMapEntries = specMapEntries.data();
+    auto computeShaderCode = readFile(shaderPath);
+    _shaderModule = createShaderModule(computeShaderCode);
 
-    shaderSpecInfo.dataSize = sizeof(params.workgroupSize);
-    shaderSpecInfo.pData = params.workgroupSize;
-
-    // Pipeline shader stage info.
-    VkPipelineShaderStageCreateInfo compShaderStageInfo{};
-    compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    compShaderStageInfo.module = computeShaderModule;
-    compShaderStageInfo.pName = "main";
-    compShaderStageInfo.pSpecializationInfo = &shaderSpecInfo;
-
-    // Create the pipeline
-    VkComputePipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineInfo.layout = _pipeline.layout;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    pipelineInfo.stage = compShaderStageInfo;
-
-    if (vkCreateComputePipelines(_device.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_pipeline.pipeline) != VK_SUCCESS)
-        throw std::runtime_error("failed to create graphics pipeline!");
-
-    vkDestroyShaderModule(_device.device, computeShaderModule, nullptr);
+    // Strings of mixed lengths; variants for a single length class are created as needed.
+    _pipeline.pipeline = createPipeline(-1);
 
     { // Upload the constants for indirect dispatch now that we have a pipeline
         renderdoc::begin_frame();
@@ -484,6 +924,52 @@ void JenkinsGpuHash::createComputePipeline()
     }
 }
 
+VkPipeline JenkinsGpuHash::createPipeline(int32_t blockCount)
+{
+    // See the specialization constants of jenkins.comp.
+    struct {
+        uint32_t workgroupSize[3];
+        int32_t blockCount;
+    } specData;
+    std::copy(std::begin(params.workgroupSize), std::end(params.workgroupSize), specData.workgroupSize);
+    specData.blockCount = blockCount;
+
+    std::vector<VkSpecializationMapEntry> specMapEntries{
+        VkSpecializationMapEntry{ 1, 0, 4 }, // Constant ID, offset, size
+        VkSpecializationMapEntry{ 2, 4, 4 }, // Constant ID, offset, size
+        VkSpecializationMapEntry{ 3, 8, 4 }, // Constant ID, offset, size
+        VkSpecializationMapEntry{ 4, 12, 4 }, // Constant ID, offset, size
+    };
+
+    VkSpecializationInfo shaderSpecInfo{};
+    shaderSpecInfo.mapEntryCount = static_cast<uint32_t>(specMapEntries.size());
+    shaderSpecInfo.pMapEntries = specMapEntries.data();
+
+    shaderSpecInfo.dataSize = sizeof(specData);
+    shaderSpecInfo.pData = &specData;
+
+    // Pipeline shader stage info.
+    VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+    compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    compShaderStageInfo.module = _shaderModule;
+    compShaderStageInfo.pName = "main";
+    compShaderStageInfo.pSpecializationInfo = &shaderSpecInfo;
+
+    // Create the pipeline
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = _pipeline.layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.stage = compShaderStageInfo;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(_device.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("failed to create graphics pipeline!");
+
+    return pipeline;
+}
+
 void JenkinsGpuHash::createCommandPool()
 {
     QueueFamilyIndices queueFamilyIndices = findQueueFamilies(_device.physicalDevice);
@@ -499,94 +985,167 @@ void JenkinsGpuHash::createCommandPool()
 void JenkinsGpuHash::createCommandBuffers()
 {
     for (Frame& frame : _frames) {
-        VkCommandBufferAllocateInfo allocInfo {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = _commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = 1;
-        vkAllocateCommandBuffers(_device.device, &allocInfo, &frame.commandBuffer);
-
-        VkCommandBufferBeginInfo beginInfo {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+        if (isGenerating())
+            frame.generatorBuffer.update(_device.device, frame.deviceBuffer.set);
+        else
+            frame.deviceBuffer.update(_device.device);
+
+        if (_targets != nullptr) {
+            targetBuffer.update(_device.device, frame.deviceBuffer.set);
+            frame.deviceHitBuffer.update(_device.device, frame.deviceBuffer.set);
+        }
 
-        if (vkBeginCommandBuffer(frame.commandBuffer, &beginInfo) != VK_SUCCESS)
-            throw std::runtime_error("failed to begin recording command buffer!");
+        if (isSeedingRuns())
+            frame.runStateBuffer.update(_device.device, frame.deviceBuffer.set);
 
-        frame.deviceBuffer.update(_device.device);
+        frame.commandBuffer = recordCommandBuffer(frame, _pipeline.pipeline);
+    }
+}
 
-        VkBufferCopy copyRegion{};
-        copyRegion.size = frame.hostInputBuffer.allocation_info.size;
-        copyRegion.dstOffset = 0;
-        copyRegion.srcOffset = 0;
-        vkCmdCopyBuffer(frame.commandBuffer, frame.hostInputBuffer.buffer, frame.deviceBuffer.buffer, 1, &copyRegion);
-
-        VkBufferMemoryBarrier bufferBarrier{};
-        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-        bufferBarrier.buffer = frame.deviceBuffer.buffer;
-        bufferBarrier.size = VK_WHOLE_SIZE;
-        bufferBarrier.buffer = frame.deviceBuffer.buffer;
-        bufferBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-        bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        vkCmdPipelineBarrier(frame.commandBuffer,
-            VK_PIPELINE_STAGE_HOST_BIT,
+VkCommandBuffer JenkinsGpuHash::recordCommandBuffer(Frame& frame, VkPipeline pipeline)
+{
+    VkCommandBuffer commandBuffer;
+
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(_device.device, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin recording command buffer!");
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = frame.hostInputBuffer.allocation_info.size;
+    copyRegion.dstOffset = 0;
+    copyRegion.srcOffset = 0;
+    if (!isGenerating())
+        vkCmdCopyBuffer(commandBuffer, frame.hostInputBuffer.buffer, frame.deviceBuffer.buffer, 1, &copyRegion);
+
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    bufferBarrier.buffer = isGenerating() ? frame.generatorBuffer.buffer : frame.deviceBuffer.buffer;
+    bufferBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        1, &bufferBarrier,
+        0, nullptr);
+
+    if (_targets != nullptr) {
+        // Reset the hit counter, and (re)write the capacity right after it.
+        vkCmdFillBuffer(commandBuffer, frame.deviceHitBuffer.buffer, 0, sizeof(uint32_t), 0);
+        vkCmdFillBuffer(commandBuffer, frame.deviceHitBuffer.buffer, sizeof(uint32_t), sizeof(uint32_t), maxHitsPerFrame);
+
+        VkBufferMemoryBarrier hitBarrier{};
+        hitBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        hitBarrier.buffer = frame.deviceHitBuffer.buffer;
+        hitBarrier.size = VK_WHOLE_SIZE;
+        hitBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hitBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        hitBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        hitBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
             0,
             0, nullptr,
-            1, &bufferBarrier,
+            1, &hitBarrier,
             0, nullptr);
+    }
 
-        vkCmdBindPipeline(frame.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline.pipeline);
-        vkCmdBindDescriptorSets(frame.commandBuffer,
-            VK_PIPELINE_BIND_POINT_COMPUTE,
-            _pipeline.layout,
-            0,
-            1,
-            &frame.deviceBuffer.set,
-            0,
-            nullptr);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        _pipeline.layout,
+        0,
+        1,
+        &frame.deviceBuffer.set,
+        0,
+        nullptr);
+
+    vkCmdDispatchIndirect(commandBuffer, dispatchBuffer.buffer, 0);
+
+    // When filtering on the device, only the hit buffer needs to be read back.
+    const bool filtering = _targets != nullptr;
+
+    // Barrier to ensure that shader writes are finished before buffer is read back from GPU
+    bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    bufferBarrier.buffer = filtering ? frame.deviceHitBuffer.buffer : frame.deviceBuffer.buffer;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        1, &bufferBarrier,
+        0, nullptr);
+
+    if (filtering) {
+        VkBufferCopy hitCopyRegion{};
+        hitCopyRegion.size = hitBufferSize;
+        vkCmdCopyBuffer(commandBuffer, frame.deviceHitBuffer.buffer, frame.hostHitBuffer.buffer, 1, &hitCopyRegion);
+    }
+    else {
+        // Packed batches only need their table back.
+        VkBufferCopy outputCopyRegion = copyRegion;
+        if (isPacked())
+            outputCopyRegion.size = packed_strings::required_words(params.getCompleteDataSize(), 0) * sizeof(uint32_t);
 
-        vkCmdDispatchIndirect(frame.commandBuffer, dispatchBuffer.buffer, 0);
+        vkCmdCopyBuffer(commandBuffer, frame.deviceBuffer.buffer, frame.hostOutputBuffer.buffer, 1, &outputCopyRegion);
+    }
 
-        // Barrier to ensure that shader writes are finished before buffer is read back from GPU
-        bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        bufferBarrier.buffer = frame.deviceBuffer.buffer;
-        bufferBarrier.size = VK_WHOLE_SIZE;
-        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    // Barrier to ensure that buffer copy is finished before host reading from it
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.buffer = filtering ? frame.hostHitBuffer.buffer : frame.hostOutputBuffer.buffer;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, nullptr,
+        1, &bufferBarrier,
+        0, nullptr);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record command buffer!");
+
+    return commandBuffer;
+}
 
-        vkCmdPipelineBarrier(
-            frame.commandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0, nullptr,
-            1, &bufferBarrier,
-            0, nullptr);
+VkCommandBuffer JenkinsGpuHash::getCommandBuffer(Frame& frame)
+{
+    if (frame.blockCount < 0)
+        return frame.commandBuffer;
 
-        vkCmdCopyBuffer(frame.commandBuffer, frame.deviceBuffer.buffer, frame.hostOutputBuffer.buffer, 1, &copyRegion);
+    auto commandBuffer = frame.blockCommandBuffers.find(frame.blockCount);
+    if (commandBuffer != frame.blockCommandBuffers.end())
+        return commandBuffer->second;
 
-        // Barrier to ensure that buffer copy is finished before host reading from it
-        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
-        bufferBarrier.buffer = frame.hostOutputBuffer.buffer;
-        bufferBarrier.size = VK_WHOLE_SIZE;
-        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    auto pipeline = _blockPipelines.find(frame.blockCount);
+    if (pipeline == _blockPipelines.end())
+        pipeline = _blockPipelines.emplace(frame.blockCount, createPipeline(frame.blockCount)).first;
 
-        vkCmdPipelineBarrier(
-            frame.commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_HOST_BIT,
-            0,
-            0, nullptr,
-            1, &bufferBarrier,
-            0, nullptr);
-
-        if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS)
-            throw std::runtime_error("failed to record command buffer!");
-    }
+    return frame.blockCommandBuffers[frame.blockCount] = recordCommandBuffer(frame, pipeline->second);
 }
 
 void JenkinsGpuHash::beginFrame()
@@ -599,12 +1158,7 @@ void JenkinsGpuHash::beginFrame()
 
 VkResult JenkinsGpuHash::submitFrame()
 {
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &_frames[_currentFrame].commandBuffer;
-
-    VkResult result = vkQueueSubmit(_computeQueue, 1, &submitInfo, _frames[_currentFrame].flightFence);
+    VkResult result = submit(_frames[_currentFrame]);
 
     renderdoc::end_frame();
 
@@ -616,6 +1170,17 @@ VkResult JenkinsGpuHash::submitFrame()
     return result;
 }
 
+VkResult JenkinsGpuHash::submit(Frame& frame)
+{
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer = getCommandBuffer(frame);
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    return vkQueueSubmit(_computeQueue, 1, &submitInfo, frame.flightFence);
+}
+
 bool JenkinsGpuHash::isDeviceSuitable(VkPhysicalDevice device)
 {
     QueueFamilyIndices indices = findQueueFamilies(device);
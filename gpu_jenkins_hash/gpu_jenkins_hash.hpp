@@ -5,11 +5,17 @@
 
 #include "buffer.hpp"
 #include "uploaded_string.hpp"
+#include "target_set.hpp"
+#include "pattern_descriptor.hpp"
+#include "packed_strings.hpp"
+#include "lookup3_batch.hpp"
 
 #include <vulkan/vulkan.h>
 #include <functional>
 #include <algorithm>
 #include <optional>
+#include <memory>
+#include <map>
 
 // FUTURE
 /*
@@ -31,6 +37,7 @@ struct Device {
     VkDevice device = VK_NULL_HANDLE;
     VmaAllocator allocator = VK_NULL_HANDLE;
     VkPhysicalDeviceProperties properties = { 0 };
+    VkPhysicalDeviceFeatures features = { 0 }; // Enabled features
 };
 
 struct Descriptor {
@@ -78,6 +85,51 @@ public:
         _outputHandler = std::function<void(uploaded_string*, size_t)>(std::move(f));
     }
 
+    // Alternatives to the two above: strings are then uploaded as packed_strings batches instead
+    // of arrays of uploaded_string. Must be set together, before run().
+    template <typename F>
+    inline void setPackedDataProvider(F f) {
+        _packedDataProvider = std::function<size_t(packed_strings&)>(std::move(f));
+    }
+
+    template <typename F>
+    inline void setPackedOutputHandler(F f) {
+        _packedOutputHandler = std::function<void(packed_strings const&)>(std::move(f));
+    }
+
+    // Optional. Queried once per frame, after the data provider ran; returns the number of blocks
+    // lookup3 mixes before the last one for every string of the frame (see length_buckets), or -1
+    // if that differs between strings. Frames of a single length class are hashed by a pipeline
+    // specialized for it, in which no invocation loops longer than the others.
+    template <typename F>
+    inline void setBlockCountProvider(F f) {
+        _blockCountProvider = std::function<int32_t()>(std::move(f));
+    }
+
+    // Optional; must be called before run(), and only applies to uploaded strings. Queried once per
+    // frame, after the data provider ran, for the runs of strings sharing a head that cover the
+    // frame. Strings of a run then resume on the device from midstates the host computes once per
+    // run and length; see lookup3_run_table.
+    template <typename F>
+    inline void setRunProvider(F f) {
+        _runProvider = std::function<void(std::vector<prefix_run>&)>(std::move(f));
+    }
+
+    // Optional; must be called before run(). Hashes are then tested against targets on the device,
+    // and only the strings that match are read back and passed to the output handler.
+    void setTargets(target_set const* targets) {
+        _targets = targets;
+    }
+
+    // Optional; must be called before run(), along with setTargets(). Candidates are then built on
+    // the device instead of being uploaded: the provider stores the pattern to enumerate and the
+    // index of the first candidate of the frame, and returns how many candidates (at most capacity)
+    // to hash. The data provider is not used.
+    template <typename F>
+    inline void setGeneratorProvider(F f) {
+        _generatorProvider = std::function<size_t(std::shared_ptr<const pattern_descriptor>&, uint64_t&, size_t)>(std::move(f));
+    }
+
     struct params_t {
         uint32_t workgroupCount[3] = { 0, 0, 0 };
         uint32_t workgroupSize[3] = { 64, 0, 0 };
@@ -105,6 +157,12 @@ public:
         params.workgroupSize[2] = std::min(_device.properties.limits.maxComputeWorkGroupSize[2], z);
     }
 
+    // Optional; must be called before run(). Frames are then filled, submitted and read back by
+    // three threads handing them over to each other, instead of one after the other, so that
+    // the host prepares and checks frames while the device hashes others. The data provider
+    // keeps running on the thread calling run(); the output handler runs on another one.
+    void setPipelined(bool pipelined) { _pipelined = pipelined; }
+
     params_t const& getParams() const { return params; }
     size_t getFrameCount() const { return _frames.size(); }
 
@@ -116,6 +174,24 @@ private:
 
     std::function<size_t(uploaded_string*, size_t)> _dataProvider;
     std::function<void(uploaded_string*, size_t)> _outputHandler;
+    std::function<size_t(std::shared_ptr<const pattern_descriptor>&, uint64_t&, size_t)> _generatorProvider;
+    std::function<size_t(packed_strings&)> _packedDataProvider;
+    std::function<void(packed_strings const&)> _packedOutputHandler;
+    std::function<int32_t()> _blockCountProvider;
+    std::function<void(std::vector<prefix_run>&)> _runProvider;
+
+    target_set const* _targets = nullptr;
+
+    bool _pipelined = false;
+
+    // Matching strings of the frame being handled, when filtering on the device.
+    std::vector<uploaded_string> _matches;
+    std::vector<uint32_t> _packedMatchStorage;
+    packed_strings _packedMatches;
+
+    // Runs of the frame being provided, and the midstates built from them.
+    std::vector<prefix_run> _runs;
+    lookup3_run_table _runTable;
 
     VkInstance _instance;
     VkDebugUtilsMessengerEXT _debugMessenger;
@@ -129,6 +205,10 @@ private:
 
     Pipeline _pipeline;
 
+    // Variants of _pipeline.pipeline for a single length class, by block count.
+    std::map<int32_t, VkPipeline> _blockPipelines;
+    VkShaderModule _shaderModule = VK_NULL_HANDLE;
+
     VkCommandPool _commandPool = VK_NULL_HANDLE;
 
     size_t _currentFrame = 0u;
@@ -138,7 +218,30 @@ private:
         buffer_t<uploaded_string> hostInputBuffer;
         buffer_t<uploaded_string> hostOutputBuffer;
 
+        // Used instead of hostOutputBuffer when filtering on the device; see jenkins.comp.
+        buffer_t<uint32_t> deviceHitBuffer;
+        buffer_t<uint32_t> hostHitBuffer;
+
+        // Used instead of deviceBuffer when generating candidates on the device; holds the base
+        // index followed by the descriptor, see jenkins.comp.
+        buffer_t<uint32_t> generatorBuffer;
+        std::shared_ptr<const pattern_descriptor> descriptor;
+        uint64_t base = 0;
+
+        // View over hostInputBuffer with the packed providers; hostOutputBuffer then only
+        // receives its header and table.
+        packed_strings packedInput;
+
+        // Midstates the strings of the frame resume from, when seeding runs; read by the shader
+        // straight from host memory, see lookup3_run_table.
+        buffer_t<uint32_t> runStateBuffer;
+
         VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+        // Length class of the strings in the frame, if they share one; see setBlockCountProvider.
+        int32_t blockCount = -1;
+        std::map<int32_t, VkCommandBuffer> blockCommandBuffers;
+
         VkCommandBuffer readTransferCommandBuffer = VK_NULL_HANDLE;
         VkCommandBuffer writeTransferCommandBuffer = VK_NULL_HANDLE;
 
@@ -153,13 +256,19 @@ private:
             deviceBuffer.release(allocator);
             hostInputBuffer.release(allocator);
             hostOutputBuffer.release(allocator);
+            deviceHitBuffer.release(allocator);
+            hostHitBuffer.release(allocator);
+            generatorBuffer.release(allocator);
+            runStateBuffer.release(allocator);
         }
     };
     buffer_t<VkDispatchIndirectCommand> dispatchBuffer;
+    buffer_t<uint32_t> targetBuffer;
 
     std::vector<Frame> _frames;
 
     void mainLoop();
+    void pipelinedLoop();
 
     void createInstance();
 
@@ -171,15 +280,38 @@ private:
 
     void createComputePipeline();
 
+    VkPipeline createPipeline(int32_t blockCount);
+
     void createCommandPool();
 
     void createCommandBuffers();
 
+    VkCommandBuffer recordCommandBuffer(Frame& frame, VkPipeline pipeline);
+
+    // Command buffer hashing the frame with the pipeline matching its block count.
+    VkCommandBuffer getCommandBuffer(Frame& frame);
+
     void beginFrame();
     VkResult submitFrame();
+    VkResult submit(Frame& frame);
 
     void createBuffers();
 
+    void uploadTargets();
+
+    size_t provideData(Frame& frame);
+    size_t provideStrings(Frame& frame);
+
+    void handleOutput(Frame& frame);
+    void handlePackedOutput(Frame& frame);
+
+    bool isGenerating() const { return static_cast<bool>(_generatorProvider); }
+    bool isPacked() const { return static_cast<bool>(_packedDataProvider); }
+    bool isSeedingRuns() const { return _runProvider && !isPacked() && !isGenerating(); }
+
+    // Number of bytes of arena in packed batches.
+    size_t packedArenaSize() const { return params.getCompleteDataSize() * packed_strings::default_bytes_per_string; }
+
     VkShaderModule createShaderModule(const std::vector<char>& code);
 
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -1,6 +1,107 @@
 #include "input_file.hpp"
+#include "pattern_dedup.hpp"
+#include "checked_math.hpp"
+
+#include <stdexcept>
 
 input_file::input_file(const char* fpath) : fs(fpath), current() {
     if (!fs.is_open())
         return;
 }
+
+void input_file::readAhead() {
+    pattern_range range;
+    while (std::getline(fs, range.pattern))
+        if (!range.pattern.empty())
+            pending.push_back(range);
+}
+
+void input_file::deduplicate() {
+    readAhead();
+
+    std::vector<std::string> lines;
+    for (pattern_range const& range : pending)
+        lines.push_back(range.pattern);
+
+    dedup_stats stats;
+    std::vector<std::string> deduplicated = deduplicate_patterns(lines, stats);
+
+    pending.clear();
+    for (std::string& line : deduplicated)
+        pending.push_back(pattern_range{ std::move(line) });
+
+    std::cout << ">> Deduplicated " << lines.size() << " patterns: " << stats.skipped << " skipped, " << stats.rewritten << " rewritten, "
+        << stats.values_before << " values down to " << stats.values_after << ".\n";
+}
+
+void input_file::shard(uint64_t index, uint64_t count) {
+    if (count == 0 || index >= count)
+        throw std::runtime_error("Invalid shard " + std::to_string(index + 1) + "/" + std::to_string(count));
+
+    readAhead();
+
+    // Values of every pattern, numbered across the whole file. Patterns are only compiled, not
+    // loaded, to be counted; those that cannot be enumerated count for nothing, and are kept in
+    // every shard, so that loading them reports them as it does without --shard.
+    std::vector<uint64_t> counts;
+    std::vector<bool> invalid;
+    uint64_t total = 0;
+    for (pattern_range const& range : pending) {
+        uint64_t values = 0;
+        bool valid = true;
+        try {
+            uint128 exact = pattern_t::compile(range.pattern).exact_count();
+            valid = exact.fits_64();
+            if (valid)
+                values = std::min(range.end, exact.low) - std::min(range.first, exact.low);
+        }
+        catch (const std::exception&) {
+            valid = false;
+        }
+
+        counts.push_back(values);
+        invalid.push_back(!valid);
+        total = checked_add(total, values, "The input file has too many values to be sharded");
+    }
+
+    // Slice i starts at floor(total * i / count), computed without overflowing.
+    auto slice = [total, count](uint64_t i) -> uint64_t {
+        return (total / count) * i + (total % count) * i / count;
+    };
+
+    const uint64_t first = slice(index);
+    const uint64_t end = slice(index + 1);
+
+    std::deque<pattern_range> lines;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        pattern_range& range = pending[i];
+        const uint64_t next = offset + counts[i];
+
+        if (invalid[i])
+            lines.push_back(std::move(range));
+        else if (counts[i] != 0 && next > first && offset < end) {
+            uint64_t base = range.first;
+            range.first = base + (std::max(first, offset) - offset);
+            range.end = base + (std::min(end, next) - offset);
+
+            lines.push_back(std::move(range));
+        }
+
+        offset = next;
+    }
+
+    pending = std::move(lines);
+
+    std::cout << ">> Shard " << (index + 1) << "/" << count << ": values " << first << " to " << end << " of " << total
+        << ", from " << pending.size() << " patterns.\n";
+}
+
+void input_file::seek(input_position const& position) {
+    pattern_range range;
+    while (patterns + 1 < position.pattern)
+        if (!readLine(range))
+            return;
+
+    resumeIndex = position.index;
+}
@@ -1,11 +1,30 @@
 #pragma once
 
+#include <deque>
+#include <limits>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <iostream>
 
 #include "pattern.hpp"
+#include "packed_strings.hpp"
+#include "lookup3_batch.hpp"
+
+// Where the enumeration of an input file stands: the number of patterns read from it so far, and
+// the index of the next value of the last of them.
+struct input_position {
+    uint64_t pattern = 0;
+    uint64_t index = 0;
+};
+
+// A line of the input file, and the range of indices of its values to enumerate; end may be
+// past the number of values of the pattern.
+struct pattern_range {
+    std::string pattern;
+    uint64_t first = 0;
+    uint64_t end = std::numeric_limits<uint64_t>::max();
+};
 
 struct input_file
 {
@@ -13,23 +32,185 @@ public:
     input_file(const char* fpath);
 
     bool next(uploaded_string& output) {
-        while (!current.has_next()) {
-            std::string line;
-            if (!std::getline(fs, line))
-                return false;
+        if (!loadNext())
+            return false;
+
+        if (!current.write(output))
+            return false;
+
+        ++produced;
+        return true;
+    }
 
-            current.load(line);
+    // Writes up to capacity values to output, moving on to the next patterns as needed; returns
+    // how many were written.
+    size_t next(uploaded_string* output, size_t capacity) {
+        size_t written = 0;
+        while (written < capacity && loadNext()) {
+            size_t count = current.write(output + written, capacity - written);
 
-            std::cout << ">> Loaded pattern '" << line << "' (" << current.count() << " possible values).\n";
+            produced += count;
+            written += count;
         }
-        return current.write(output);
+        return written;
+    }
+
+    // Same as next(), but stops at the end of the run of values of the current pattern that share
+    // a head (see pattern_t::head()); stores it in run.
+    size_t nextRun(uploaded_string* output, size_t capacity, prefix_run& run) {
+        if (!loadNext())
+            return 0;
+
+        run.prefix = current.head();
+
+        size_t count = current.write(output, size_t(std::min<uint64_t>(capacity, current.run_remaining())));
+        produced += count;
+        return count;
+    }
+
+    // Same as next(), but also hashes the value; see pattern_t::write.
+    bool next(uploaded_string& output, lookup3_incremental& hasher) {
+        if (!loadNext())
+            return false;
+
+        if (!current.write(output, hasher))
+            return false;
+
+        ++produced;
+        return true;
+    }
+
+    // Writes the next value, up to uploaded_string::max_length characters, to storage.
+    bool next(char* storage, size_t& length) {
+        if (!loadNext())
+            return false;
+
+        if (!current.write(storage, length))
+            return false;
+
+        ++produced;
+        return true;
+    }
+
+    // Appends the next value to output; returns false once output is full or the file is exhausted.
+    bool next(packed_strings& output) {
+        if (!loadNext())
+            return false;
+
+        char* storage = output.reserve(longest);
+        if (storage == nullptr)
+            return false;
+
+        size_t length = 0;
+        if (!next(storage, length))
+            return false;
+
+        output.commit(length);
+        return true;
     }
 
     bool hasNext() {
-        return current.has_next() || !fs.eof();
+        return current.has_next() || !pending.empty() || !fs.eof();
+    }
+
+    // Reads the rest of the file at once and runs it through deduplicate_patterns(), so that values
+    // produced by several lines are only produced once; patterns are then served from memory.
+    // Must come before shard().
+    void deduplicate();
+
+    // Reads the rest of the file at once, and only keeps the index-th of count slices of the
+    // values of all of its patterns, taken in order; slices hold as many values as possible, and
+    // together every value exactly once. index starts at 0. Patterns that cannot be enumerated
+    // are kept in every slice, to fail there as they would have otherwise.
+    void shard(uint64_t index, uint64_t count);
+
+    // Constant prefix of the pattern currently being enumerated.
+    std::string_view prefix() const {
+        return current.prefix();
     }
 
+    // Number of values written since the current pattern was loaded.
+    size_t producedFromCurrent() const {
+        return produced;
+    }
+
+    // Reads the next non-empty line of the file as is, along with the range of its values to
+    // enumerate, for engines that enumerate patterns themselves (see pattern_descriptor).
+    bool nextPattern(pattern_range& range) {
+        while (readLine(range)) {
+            if (range.pattern.empty())
+                continue;
+
+            range.first = std::max(range.first, resumeIndex);
+            resumeIndex = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Position of the next value written by next(); callers of nextPattern() keep track of the
+    // index themselves.
+    input_position position() const {
+        return input_position{ patterns, current.next_index() };
+    }
+
+    // Number of lines read from the file, including the pattern being enumerated.
+    uint64_t patternsRead() const {
+        return patterns;
+    }
+
+    // Skips ahead to position, as returned by position() in an earlier run over the same file.
+    // Must be called before anything is read.
+    void seek(input_position const& position);
+
 private:
+    // Moves on to the next pattern of the file once the current one is exhausted.
+    bool loadNext() {
+        while (!current.has_next()) {
+            pattern_range range;
+            if (!readLine(range))
+                return false;
+
+            current.load(range.pattern);
+            current.limit(range.end);
+            current.seek(std::max(range.first, resumeIndex));
+            resumeIndex = 0;
+            produced = 0;
+            longest = current.compiled().longest();
+
+            std::cout << ">> Loaded pattern '" << range.pattern << "' (" << current.count() << " possible values).\n";
+        }
+        return true;
+    }
+
+    bool readLine(pattern_range& range) {
+        if (pending.empty()) {
+            range = pattern_range();
+            if (!std::getline(fs, range.pattern))
+                return false;
+        }
+        else {
+            range = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        ++patterns;
+        return true;
+    }
+
+    // Reads the lines left in the file into pending, skipping empty ones.
+    void readAhead();
+
     std::fstream fs;
+    std::deque<pattern_range> pending;  // lines read ahead by deduplicate() or shard()
     pattern_t current;
+    size_t produced = 0;
+
+    // Length of the longest value of current; packed batches only need that much room per value.
+    size_t longest = 0;
+    uint64_t patterns = 0;
+
+    // Index the next pattern loaded starts from; see seek().
+    uint64_t resumeIndex = 0;
 };
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "keyspace_plan.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // Rounds lookup3 mixes a value of that many characters with; every value takes at least one.
+    double blocks(double length) {
+        return std::max(1.0, std::ceil(length / 12.0));
+    }
+
+    // Average length of the values of a pattern: the sum of the average lengths of its steps,
+    // since each step varies independently of the others.
+    double average_length(pattern_program const& program) {
+        double length = 0;
+        for (pattern_step const& step : program.steps) {
+            if (step.kind == pattern_step::literal)
+                length += step.size;
+            else if (step.listed()) {
+                double sum = 0;
+                for (uint32_t i = 0; i < step.size; ++i)
+                    sum += program.value(step, i).size();
+
+                length += sum / step.size;
+            }
+            else if (step.kind == pattern_step::mangled) {
+                // Every value would take too long; rules are applied to a sample of words instead,
+                // spread evenly over all of them.
+                const uint64_t samples = std::min<uint64_t>(step.count, 4096);
+
+                char value[uploaded_string::max_length];
+                double sum = 0;
+                for (uint64_t i = 0; i < samples; ++i)
+                    sum += program.mangle(step, std::min(step.count - 1, uint64_t(double(step.count) * i / samples)), value);
+
+                length += sum / samples;
+            }
+            else {
+                // Lengths are weighted by their number of values, relative to the longest one so
+                // that the weights of large alphabets do not overflow.
+                double weights = 0;
+                double sum = 0;
+                for (uint32_t l = step.min_length; l <= step.max_length; ++l) {
+                    double weight = std::pow(double(step.size), double(l) - double(step.max_length));
+                    weights += weight;
+                    sum += weight * l;
+                }
+
+                length += sum / weights;
+            }
+        }
+        return length;
+    }
+
+    std::string format_duration(double seconds) {
+        std::ostringstream oss;
+        if (!std::isfinite(seconds))
+            oss << "unknown";
+        else if (seconds >= 100.0 * 365 * 86400)
+            oss << std::setprecision(3) << seconds / (365.0 * 86400) << " years";
+        else {
+            uint64_t total = uint64_t(std::ceil(seconds));
+            uint64_t days = total / 86400;
+            if (days != 0)
+                oss << days << "d ";
+
+            oss << std::setfill('0') << std::setw(2) << (total / 3600) % 24 << ":"
+                << std::setw(2) << (total / 60) % 60 << ":"
+                << std::setw(2) << total % 60;
+        }
+        return oss.str();
+    }
+}
+
+keyspace_plan::keyspace_plan(input_file& input, std::chrono::seconds calibration) : _calibration(calibration)
+{
+    pattern_range range;
+    while (input.nextPattern(range)) {
+        line_t line;
+        line.pattern = range.pattern;
+
+        try {
+            pattern_program program = pattern_t::compile(range.pattern);
+
+            uint128 total = program.exact_count();
+            line.count = total;
+            if (total.fits_64())
+                line.count = std::min(range.end, total.low) - std::min(range.first, total.low);
+
+            line.blocks = blocks(average_length(program));
+
+            if (program.longest() > uploaded_string::max_length)
+                line.error = "values may be longer than " + std::to_string(uploaded_string::max_length) + " characters";
+            else if (!total.fits_64())
+                line.error = "more than 2^64 values";
+            else if (line.count != 0) {
+                sample_t sample{ pattern_t(range.pattern), range.first };
+                sample.pattern.limit(range.end);
+                sample.pattern.seek(range.first);
+
+                _samples.push_back(std::move(sample));
+            }
+        }
+        catch (const std::exception& e) {
+            line.error = e.what();
+        }
+
+        _lines.push_back(std::move(line));
+    }
+}
+
+size_t keyspace_plan::fill(uploaded_string* output, size_t capacity)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!_started) {
+        _deadline = now + _calibration;
+        _started = true;
+    }
+
+    size_t count = 0;
+    if (!_samples.empty() && now < _deadline) {
+        // Every line gets an equal share of each frame, so that the rate is that of the whole file.
+        const size_t share = std::max<size_t>(1, capacity / _samples.size());
+
+        while (count < capacity) {
+            sample_t& sample = _samples[_nextSample];
+            _nextSample = (_nextSample + 1) % _samples.size();
+
+            size_t written = 0;
+            while (written < share && count + written < capacity) {
+                if (!sample.pattern.has_next())
+                    sample.pattern.seek(sample.first);
+
+                written += sample.pattern.write(output + count + written, std::min(share - written, capacity - count - written));
+            }
+
+            for (size_t i = 0; i < written; ++i)
+                _sampledBlocks += blocks(double(output[count + i].value().size()));
+
+            count += written;
+        }
+
+        _sampled += count;
+    }
+
+    memset(output + count, 0, sizeof(uploaded_string) * (capacity - count));
+    return count;
+}
+
+void keyspace_plan::print(std::ostream& out, double hashes_per_second) const
+{
+    // Blocks per second of the calibration run, which every line is assumed to reach as well.
+    const double block_rate = _sampled == 0 ? 0 : hashes_per_second * (_sampledBlocks / _sampled);
+
+    uint128 total;
+    bool overflow = false;
+    double seconds = 0;
+    size_t unhashable = 0;
+
+    out << ">> Plan for " << _lines.size() << " patterns:\n";
+    for (line_t const& line : _lines) {
+        out << "   " << line.pattern << "\n";
+        if (!line.error.empty() && line.count == uint128()) {
+            out << "      " << line.error << "\n";
+            ++unhashable;
+            continue;
+        }
+
+        const double line_seconds = line.count == uint128() ? 0 : double(line.count) * line.blocks / block_rate;
+
+        out << "      " << line.count.to_string() << " values, " << format_duration(line_seconds);
+        if (!line.error.empty()) {
+            out << " (cannot be hashed: " << line.error << ")";
+            ++unhashable;
+        }
+        else
+            seconds += line_seconds;
+        out << "\n";
+
+        if (line.error.empty() && !uint128::add(total, line.count, total))
+            overflow = true;
+    }
+
+    out << ">> Total: " << (overflow ? "more than 2^128" : total.to_string()) << " values, " << format_duration(seconds);
+    if (block_rate != 0)
+        out << " at " << uint64_t(hashes_per_second) << " hashes per second";
+    if (unhashable != 0)
+        out << ", leaving out " << unhashable << " patterns that cannot be hashed";
+    out << "." << std::endl;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "input_file.hpp"
+#include "pattern.hpp"
+#include "uint128.hpp"
+#include "uploaded_string.hpp"
+
+// What --plan prints instead of running: the exact number of values of every line of the input
+// file and of the whole file, and how long hashing them would take.
+//
+// Times are estimated from a short calibration run on the engine that would do the work, fed by
+// fill() with values of every line in turn. Hashing a value costs about one round per 12-byte
+// block, so the rate measured is scaled, for every line, by the ratio of the average block count
+// of the sample to the block count of the average value of that line.
+class keyspace_plan {
+public:
+    // Reads every line left in input, honouring --dedupe and --shard.
+    keyspace_plan(input_file& input, std::chrono::seconds calibration);
+
+    // Data provider for the calibration run; ends it once the calibration time has elapsed since
+    // the first call. Zero right away if no line can be enumerated.
+    size_t fill(uploaded_string* output, size_t capacity);
+
+    // Prints the plan, given the rate the calibration run reached.
+    void print(std::ostream& out, double hashes_per_second) const;
+
+private:
+    struct line_t {
+        std::string pattern;
+        uint128 count;
+        double blocks = 1;      // of the average value
+        std::string error;      // why the line cannot be hashed, if it cannot
+    };
+
+    struct sample_t {
+        pattern_t pattern;
+        uint64_t first;
+    };
+
+    std::vector<line_t> _lines;
+    std::vector<sample_t> _samples;
+    size_t _nextSample = 0;
+
+    std::chrono::seconds _calibration;
+    std::chrono::steady_clock::time_point _deadline;
+    bool _started = false;
+
+    uint64_t _sampled = 0;
+    double _sampledBlocks = 0;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "uploaded_string.hpp"
+
+// Regroups the values of a source by length class before they are uploaded, so that every frame
+// holds strings that lookup3 mixes the same number of times. On the GPU, no invocation of a
+// workgroup then waits on a neighbour with a longer string; on the CPU, vector lanes stay in step.
+//
+// The length class of a string is the number of 12-byte blocks hashlittle() mixes before the
+// last one. Values are held back in one bucket per class until a bucket fills a whole frame;
+// once the source is exhausted, the remaining buckets are flushed largest first.
+class length_buckets {
+public:
+    constexpr static const size_t block_size = 12;
+    constexpr static const size_t class_count = (uploaded_string::max_length + block_size - 1) / block_size;
+
+    static uint32_t class_of(size_t length) {
+        return length == 0 ? 0 : uint32_t((length - 1) / block_size);
+    }
+
+    // Writes up to capacity strings of a single length class to output, pulling values from
+    // source, a bool(char* storage, size_t& length) callable writing up to
+    // uploaded_string::max_length characters; it returns false once exhausted. Returns the number
+    // of strings written, zero once everything was, and sets length_class to their class.
+    template <typename Source>
+    size_t fill(uploaded_string* output, size_t capacity, Source&& source, uint32_t& length_class) {
+        size_t ready = class_count;
+
+        while (!_exhausted && ready == class_count) {
+            size_t length = 0;
+            if (!source(_value, length)) {
+                _exhausted = true;
+                break;
+            }
+
+            uint32_t value_class = class_of(length);
+
+            bucket& target = _buckets[value_class];
+            target.chars.append(_value, length);
+            target.ends.push_back(uint32_t(target.chars.size()));
+
+            if (target.ends.size() >= capacity)
+                ready = value_class;
+        }
+
+        if (ready == class_count) {
+            // Nothing filled a frame; flush the largest bucket left.
+            size_t largest = 0;
+            for (size_t i = 0; i < class_count; ++i) {
+                if (_buckets[i].ends.size() > largest) {
+                    largest = _buckets[i].ends.size();
+                    ready = i;
+                }
+            }
+
+            if (ready == class_count)
+                return 0;
+        }
+
+        bucket& source_bucket = _buckets[ready];
+        size_t count = std::min(capacity, source_bucket.ends.size());
+
+        uint32_t begin = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t end = source_bucket.ends[i];
+
+            output[i].assign(std::string_view(source_bucket.chars.data() + begin, end - begin));
+            begin = end;
+        }
+
+        // Buckets are flushed as soon as they fill a frame, so they never hold more than one.
+        source_bucket.chars.clear();
+        source_bucket.ends.clear();
+
+        length_class = uint32_t(ready);
+        return count;
+    }
+
+private:
+    // Values of a class, back to back, and the offset one past the end of each.
+    struct bucket {
+        std::string chars;
+        std::vector<uint32_t> ends;
+    };
+
+    bucket _buckets[class_count];
+    bool _exhausted = false;
+
+    char _value[uploaded_string::max_length];
+};
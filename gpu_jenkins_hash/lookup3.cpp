@@ -341,6 +341,66 @@ uint32_t hashlittle(const void *key, size_t length, uint32_t initval)
     return c;
 }
 /*
+* hashlittle_blocks(), hashlittle_tail(): the aligned branch of hashlittle(), split in two
+* so that the state after some leading blocks of a key can be saved and resumed from.
+*
+* hashlittle_blocks() mixes count full 12-byte blocks into (*pa, *pb, *pc). It must only be
+* used for blocks that hashlittle() itself would mix, i.e. blocks followed by at least one
+* more byte of key: hashlittle() leaves the last block of a key to final(), even when it is a
+* full one, so a key of n > 0 bytes has (n - 1) / 12 blocks to mix and an empty key none.
+* hashlittle_tail() hashes the remaining length bytes of the key from the provided state.
+*
+* For a 4-byte aligned key of n bytes,
+*   a = b = c = 0xdeadbeef + n + initval;
+*   hashlittle_blocks(k, i, &a, &b, &c);
+*   hashlittle_tail(k + 3 * i, n - 12 * i, a, b, c) == hashlittle(k, n, initval)
+* for every i <= (n - 1) / 12.
+*/
+void hashlittle_blocks(const uint32_t *k, size_t count, uint32_t *pa, uint32_t *pb, uint32_t *pc)
+{
+    uint32_t a = *pa, b = *pb, c = *pc;
+    for (; count > 0; --count)
+    {
+        a += k[0];
+        b += k[1];
+        c += k[2];
+        mix(a, b, c);
+        k += 3;
+    }
+    *pa = a; *pb = b; *pc = c;
+}
+
+uint32_t hashlittle_tail(const uint32_t *k, size_t length, uint32_t a, uint32_t b, uint32_t c)
+{
+    while (length > 12)
+    {
+        a += k[0];
+        b += k[1];
+        c += k[2];
+        mix(a, b, c);
+        length -= 12;
+        k += 3;
+    }
+    switch (length)
+    {
+    case 12: c += k[2]; b += k[1]; a += k[0]; break;
+    case 11: c += k[2] & 0xffffff; b += k[1]; a += k[0]; break;
+    case 10: c += k[2] & 0xffff; b += k[1]; a += k[0]; break;
+    case 9: c += k[2] & 0xff; b += k[1]; a += k[0]; break;
+    case 8: b += k[1]; a += k[0]; break;
+    case 7: b += k[1] & 0xffffff; a += k[0]; break;
+    case 6: b += k[1] & 0xffff; a += k[0]; break;
+    case 5: b += k[1] & 0xff; a += k[0]; break;
+    case 4: a += k[0]; break;
+    case 3: a += k[0] & 0xffffff; break;
+    case 2: a += k[0] & 0xffff; break;
+    case 1: a += k[0] & 0xff; break;
+    case 0: return c;              /* zero length strings require no mixing */
+    }
+    final(a, b, c);
+    return c;
+}
+/*
 * hashlittle2: return 2 32-bit hash values
 *
 * This is identical to hashlittle(), except it returns two 32-bit hash
@@ -5,3 +5,8 @@
 uint32_t hashword(const uint32_t* source, size_t length, uint32_t initval);
 
 uint32_t hashlittle(const void *key, size_t length, uint32_t initval);
+
+// Aligned hashlittle() split at a block boundary; see lookup3.cpp.
+void hashlittle_blocks(const uint32_t* k, size_t count, uint32_t* pa, uint32_t* pb, uint32_t* pc);
+
+uint32_t hashlittle_tail(const uint32_t* k, size_t length, uint32_t a, uint32_t b, uint32_t c);
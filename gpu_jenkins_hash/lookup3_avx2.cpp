@@ -0,0 +1,145 @@
+#include "lookup3_batch.hpp"
+#include "cpu_features.hpp"
+
+#include <immintrin.h>
+#include <algorithm>
+
+// 8-lane AVX2 implementation of hashlittle() over uploaded_string records.
+//
+// Each lane hashes one record. Records are gathered straight out of the frame: they are
+// 4-byte aligned and zero-padded to 384 bytes, which is the case the aligned branch of
+// hashlittle() handles (read whole words, mask off the bytes past the end of the key).
+// Lanes of different lengths stay in lockstep; a lane stops accepting new state as soon as it
+// runs out of full blocks, and its tail is masked according to its own length. When the records
+// start with a known prefix, each lane resumes from its midstate and skips the blocks it covers.
+
+static_assert(sizeof(uploaded_string) % sizeof(uint32_t) == 0, "uploaded_string must be made of whole words");
+
+namespace {
+    constexpr const int lane_count = 8;
+    constexpr const int record_stride = int(sizeof(uploaded_string) / sizeof(uint32_t));
+
+    struct state_t {
+        __m256i a, b, c;
+    };
+
+    template <int K>
+    CPU_TARGET_AVX2 inline __m256i rot(__m256i x) {
+        return _mm256_or_si256(_mm256_slli_epi32(x, K), _mm256_srli_epi32(x, 32 - K));
+    }
+
+    CPU_TARGET_AVX2 inline void mix(state_t& s) {
+        s.a = _mm256_sub_epi32(s.a, s.c); s.a = _mm256_xor_si256(s.a, rot<4>(s.c));  s.c = _mm256_add_epi32(s.c, s.b);
+        s.b = _mm256_sub_epi32(s.b, s.a); s.b = _mm256_xor_si256(s.b, rot<6>(s.a));  s.a = _mm256_add_epi32(s.a, s.c);
+        s.c = _mm256_sub_epi32(s.c, s.b); s.c = _mm256_xor_si256(s.c, rot<8>(s.b));  s.b = _mm256_add_epi32(s.b, s.a);
+        s.a = _mm256_sub_epi32(s.a, s.c); s.a = _mm256_xor_si256(s.a, rot<16>(s.c)); s.c = _mm256_add_epi32(s.c, s.b);
+        s.b = _mm256_sub_epi32(s.b, s.a); s.b = _mm256_xor_si256(s.b, rot<19>(s.a)); s.a = _mm256_add_epi32(s.a, s.c);
+        s.c = _mm256_sub_epi32(s.c, s.b); s.c = _mm256_xor_si256(s.c, rot<4>(s.b));  s.b = _mm256_add_epi32(s.b, s.a);
+    }
+
+    CPU_TARGET_AVX2 inline void final(state_t& s) {
+        s.c = _mm256_xor_si256(s.c, s.b); s.c = _mm256_sub_epi32(s.c, rot<14>(s.b));
+        s.a = _mm256_xor_si256(s.a, s.c); s.a = _mm256_sub_epi32(s.a, rot<11>(s.c));
+        s.b = _mm256_xor_si256(s.b, s.a); s.b = _mm256_sub_epi32(s.b, rot<25>(s.a));
+        s.c = _mm256_xor_si256(s.c, s.b); s.c = _mm256_sub_epi32(s.c, rot<16>(s.b));
+        s.a = _mm256_xor_si256(s.a, s.c); s.a = _mm256_sub_epi32(s.a, rot<4>(s.c));
+        s.b = _mm256_xor_si256(s.b, s.a); s.b = _mm256_sub_epi32(s.b, rot<14>(s.a));
+        s.c = _mm256_xor_si256(s.c, s.b); s.c = _mm256_sub_epi32(s.c, rot<24>(s.b));
+    }
+
+    // Mask keeping the first n bytes of a word, for n in [0, 4].
+    // vpsllvd yields 0 for shift counts of 32 and up, which is exactly the n == 4 case.
+    CPU_TARGET_AVX2 inline __m256i byte_mask(__m256i n) {
+        __m256i ones = _mm256_set1_epi32(-1);
+        return _mm256_xor_si256(_mm256_sllv_epi32(ones, _mm256_slli_epi32(n, 3)), ones);
+    }
+
+    CPU_TARGET_AVX2 inline __m256i clamp_bytes(__m256i n) {
+        return _mm256_min_epi32(_mm256_max_epi32(n, _mm256_setzero_si256()), _mm256_set1_epi32(4));
+    }
+
+    CPU_TARGET_AVX2 void hash_lanes(uploaded_string* data, lookup3_seeds seeds) {
+        const int* base = reinterpret_cast<const int*>(data);
+        const int words_offset = int(reinterpret_cast<const char*>(data->value().data()) - reinterpret_cast<const char*>(data)) / 4;
+
+        // Per-lane setup: starting state (possibly resumed from the prefix midstate), first word
+        // to read, and number of blocks left to mix before the final (possibly partial) one -
+        // hashlittle() loops while more than 12 bytes remain.
+        alignas(32) int32_t lengths[lane_count];
+        alignas(32) int32_t first_word[lane_count];
+        alignas(32) int32_t blocks[lane_count];
+        alignas(32) int32_t tails[lane_count];
+        alignas(32) uint32_t seed_a[lane_count], seed_b[lane_count], seed_c[lane_count];
+
+        int max_blocks = 0;
+        for (int i = 0; i < lane_count; ++i) {
+            lookup3_state state;
+            int32_t skipped = int32_t(seeds.seed(i, data[i], state));
+
+            lengths[i] = int32_t(data[i].value().size());
+            first_word[i] = i * record_stride + words_offset + skipped * 3;
+            blocks[i] = lengths[i] > 0 ? (lengths[i] - 1) / 12 - skipped : 0;
+            tails[i] = lengths[i] - (skipped + blocks[i]) * 12;
+            seed_a[i] = state.a;
+            seed_b[i] = state.b;
+            seed_c[i] = state.c;
+
+            max_blocks = std::max(max_blocks, blocks[i]);
+        }
+
+        const __m256i length = _mm256_load_si256(reinterpret_cast<const __m256i*>(lengths));
+        const __m256i remaining = _mm256_load_si256(reinterpret_cast<const __m256i*>(blocks));
+
+        state_t s;
+        s.a = _mm256_load_si256(reinterpret_cast<const __m256i*>(seed_a));
+        s.b = _mm256_load_si256(reinterpret_cast<const __m256i*>(seed_b));
+        s.c = _mm256_load_si256(reinterpret_cast<const __m256i*>(seed_c));
+
+        __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i*>(first_word));
+        for (int block = 0; block < max_blocks; ++block) {
+            __m256i active = _mm256_cmpgt_epi32(remaining, _mm256_set1_epi32(block));
+
+            state_t m = s;
+            m.a = _mm256_add_epi32(m.a, _mm256_i32gather_epi32(base, index, 4));
+            m.b = _mm256_add_epi32(m.b, _mm256_i32gather_epi32(base + 1, index, 4));
+            m.c = _mm256_add_epi32(m.c, _mm256_i32gather_epi32(base + 2, index, 4));
+            mix(m);
+
+            s.a = _mm256_blendv_epi8(s.a, m.a, active);
+            s.b = _mm256_blendv_epi8(s.b, m.b, active);
+            s.c = _mm256_blendv_epi8(s.c, m.c, active);
+
+            index = _mm256_add_epi32(index, _mm256_and_si256(active, _mm256_set1_epi32(3)));
+        }
+
+        // Last block: 1 to 12 bytes for non-empty keys.
+        const __m256i has_data = _mm256_cmpgt_epi32(length, _mm256_setzero_si256());
+        const __m256i tail = _mm256_load_si256(reinterpret_cast<const __m256i*>(tails));
+
+        state_t f = s;
+        f.a = _mm256_add_epi32(f.a, _mm256_and_si256(_mm256_i32gather_epi32(base, index, 4),
+            byte_mask(clamp_bytes(tail))));
+        f.b = _mm256_add_epi32(f.b, _mm256_and_si256(_mm256_i32gather_epi32(base + 1, index, 4),
+            byte_mask(clamp_bytes(_mm256_sub_epi32(tail, _mm256_set1_epi32(4))))));
+        f.c = _mm256_add_epi32(f.c, _mm256_and_si256(_mm256_i32gather_epi32(base + 2, index, 4),
+            byte_mask(clamp_bytes(_mm256_sub_epi32(tail, _mm256_set1_epi32(8))))));
+        final(f);
+
+        // Zero length strings require no mixing.
+        __m256i hash = _mm256_blendv_epi8(s.c, f.c, has_data);
+
+        alignas(32) uint32_t hashes[lane_count];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(hashes), hash);
+        for (int i = 0; i < lane_count; ++i)
+            data[i].set_hash(hashes[i]);
+    }
+}
+
+void hashlittle_batch_avx2(uploaded_string* data, size_t count, lookup3_seeds seeds)
+{
+    size_t i = 0;
+    for (; i + lane_count <= count; i += lane_count)
+        hash_lanes(data + i, seeds + i);
+
+    hashlittle_batch_scalar(data + i, count - i, seeds + i);
+}
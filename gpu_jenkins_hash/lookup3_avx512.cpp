@@ -0,0 +1,141 @@
+#include "lookup3_batch.hpp"
+#include "cpu_features.hpp"
+
+#include <immintrin.h>
+#include <algorithm>
+
+// 16-lane AVX-512 implementation of hashlittle() over uploaded_string records.
+//
+// Same layout assumptions as the AVX2 kernel (see lookup3_avx2.cpp), but:
+// - rot() is a single vprold instead of two shifts and an or,
+// - lanes that are done, or words that lie past the end of a lane's key, are excluded from the
+//   gathers with opmasks instead of being loaded and blended away,
+// - a partial batch at the end of a frame is handled by masking lanes off rather than by
+//   falling back to the scalar kernel.
+
+static_assert(sizeof(uploaded_string) % sizeof(uint32_t) == 0, "uploaded_string must be made of whole words");
+
+namespace {
+    constexpr const int lane_count = 16;
+    constexpr const int record_stride = int(sizeof(uploaded_string) / sizeof(uint32_t));
+
+    struct state_t {
+        __m512i a, b, c;
+    };
+
+    CPU_TARGET_AVX512 inline void mix(state_t& s) {
+        s.a = _mm512_sub_epi32(s.a, s.c); s.a = _mm512_xor_si512(s.a, _mm512_rol_epi32(s.c, 4));  s.c = _mm512_add_epi32(s.c, s.b);
+        s.b = _mm512_sub_epi32(s.b, s.a); s.b = _mm512_xor_si512(s.b, _mm512_rol_epi32(s.a, 6));  s.a = _mm512_add_epi32(s.a, s.c);
+        s.c = _mm512_sub_epi32(s.c, s.b); s.c = _mm512_xor_si512(s.c, _mm512_rol_epi32(s.b, 8));  s.b = _mm512_add_epi32(s.b, s.a);
+        s.a = _mm512_sub_epi32(s.a, s.c); s.a = _mm512_xor_si512(s.a, _mm512_rol_epi32(s.c, 16)); s.c = _mm512_add_epi32(s.c, s.b);
+        s.b = _mm512_sub_epi32(s.b, s.a); s.b = _mm512_xor_si512(s.b, _mm512_rol_epi32(s.a, 19)); s.a = _mm512_add_epi32(s.a, s.c);
+        s.c = _mm512_sub_epi32(s.c, s.b); s.c = _mm512_xor_si512(s.c, _mm512_rol_epi32(s.b, 4));  s.b = _mm512_add_epi32(s.b, s.a);
+    }
+
+    CPU_TARGET_AVX512 inline void final(state_t& s) {
+        s.c = _mm512_xor_si512(s.c, s.b); s.c = _mm512_sub_epi32(s.c, _mm512_rol_epi32(s.b, 14));
+        s.a = _mm512_xor_si512(s.a, s.c); s.a = _mm512_sub_epi32(s.a, _mm512_rol_epi32(s.c, 11));
+        s.b = _mm512_xor_si512(s.b, s.a); s.b = _mm512_sub_epi32(s.b, _mm512_rol_epi32(s.a, 25));
+        s.c = _mm512_xor_si512(s.c, s.b); s.c = _mm512_sub_epi32(s.c, _mm512_rol_epi32(s.b, 16));
+        s.a = _mm512_xor_si512(s.a, s.c); s.a = _mm512_sub_epi32(s.a, _mm512_rol_epi32(s.c, 4));
+        s.b = _mm512_xor_si512(s.b, s.a); s.b = _mm512_sub_epi32(s.b, _mm512_rol_epi32(s.a, 14));
+        s.c = _mm512_xor_si512(s.c, s.b); s.c = _mm512_sub_epi32(s.c, _mm512_rol_epi32(s.b, 24));
+    }
+
+    // Gathers the tail word at index + offset, keeping only its first (tail - skip) bytes.
+    // Lanes that have no byte left in that word do not touch memory at all.
+    CPU_TARGET_AVX512 inline __m512i tail_word(const int* base, __m512i index, __m512i tail, int skip) {
+        __m512i remaining = _mm512_sub_epi32(tail, _mm512_set1_epi32(skip));
+        __mmask16 present = _mm512_cmpgt_epi32_mask(remaining, _mm512_setzero_si512());
+
+        __m512i word = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), present, index, base, 4);
+
+        // vpsllvd yields 0 for shift counts of 32 and up, so full words keep every bit.
+        __m512i ones = _mm512_set1_epi32(-1);
+        __m512i bytes = _mm512_min_epi32(remaining, _mm512_set1_epi32(4));
+        __m512i mask = _mm512_xor_si512(_mm512_sllv_epi32(ones, _mm512_slli_epi32(bytes, 3)), ones);
+
+        return _mm512_and_si512(word, mask);
+    }
+
+    CPU_TARGET_AVX512 void hash_lanes(uploaded_string* data, int count, lookup3_seeds seeds) {
+        const int* base = reinterpret_cast<const int*>(data);
+        const int words_offset = int(reinterpret_cast<const char*>(data->value().data()) - reinterpret_cast<const char*>(data)) / 4;
+
+        // Per-lane setup; see lookup3_avx2.cpp. Unused lanes have no data and no blocks, so they
+        // never read memory.
+        alignas(64) int32_t lengths[lane_count] = { 0 };
+        alignas(64) int32_t first_word[lane_count] = { 0 };
+        alignas(64) int32_t blocks[lane_count] = { 0 };
+        alignas(64) int32_t tails[lane_count] = { 0 };
+        alignas(64) uint32_t seed_a[lane_count] = { 0 }, seed_b[lane_count] = { 0 }, seed_c[lane_count] = { 0 };
+
+        int max_blocks = 0;
+        for (int i = 0; i < count; ++i) {
+            lookup3_state state;
+            int32_t skipped = int32_t(seeds.seed(i, data[i], state));
+
+            lengths[i] = int32_t(data[i].value().size());
+            first_word[i] = i * record_stride + words_offset + skipped * 3;
+            blocks[i] = lengths[i] > 0 ? (lengths[i] - 1) / 12 - skipped : 0;
+            tails[i] = lengths[i] - (skipped + blocks[i]) * 12;
+            seed_a[i] = state.a;
+            seed_b[i] = state.b;
+            seed_c[i] = state.c;
+
+            max_blocks = std::max(max_blocks, blocks[i]);
+        }
+
+        const __m512i remaining = _mm512_load_si512(blocks);
+
+        state_t s;
+        s.a = _mm512_load_si512(seed_a);
+        s.b = _mm512_load_si512(seed_b);
+        s.c = _mm512_load_si512(seed_c);
+
+        __m512i index = _mm512_load_si512(first_word);
+        for (int block = 0; block < max_blocks; ++block) {
+            __mmask16 active = _mm512_cmpgt_epi32_mask(remaining, _mm512_set1_epi32(block));
+
+            state_t m = s;
+            m.a = _mm512_add_epi32(m.a, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, index, base, 4));
+            m.b = _mm512_add_epi32(m.b, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, index, base + 1, 4));
+            m.c = _mm512_add_epi32(m.c, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, index, base + 2, 4));
+            mix(m);
+
+            s.a = _mm512_mask_mov_epi32(s.a, active, m.a);
+            s.b = _mm512_mask_mov_epi32(s.b, active, m.b);
+            s.c = _mm512_mask_mov_epi32(s.c, active, m.c);
+
+            index = _mm512_mask_add_epi32(index, active, index, _mm512_set1_epi32(3));
+        }
+
+        // Last block: 1 to 12 bytes for non-empty keys.
+        const __mmask16 has_data = _mm512_cmpgt_epi32_mask(_mm512_load_si512(lengths), _mm512_setzero_si512());
+        const __m512i tail = _mm512_load_si512(tails);
+
+        state_t f = s;
+        f.a = _mm512_add_epi32(f.a, tail_word(base, index, tail, 0));
+        f.b = _mm512_add_epi32(f.b, tail_word(base + 1, index, tail, 4));
+        f.c = _mm512_add_epi32(f.c, tail_word(base + 2, index, tail, 8));
+        final(f);
+
+        // Zero length strings require no mixing.
+        __m512i hash = _mm512_mask_mov_epi32(s.c, has_data, f.c);
+
+        alignas(64) uint32_t hashes[lane_count];
+        _mm512_store_si512(hashes, hash);
+        for (int i = 0; i < count; ++i)
+            data[i].set_hash(hashes[i]);
+    }
+}
+
+void hashlittle_batch_avx512(uploaded_string* data, size_t count, lookup3_seeds seeds)
+{
+    size_t i = 0;
+    for (; i + lane_count <= count; i += lane_count)
+        hash_lanes(data + i, lane_count, seeds + i);
+
+    if (i < count)
+        hash_lanes(data + i, int(count - i), seeds + i);
+}
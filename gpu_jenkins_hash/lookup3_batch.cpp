@@ -0,0 +1,235 @@
+#include "lookup3_batch.hpp"
+#include "cpu_features.hpp"
+#include "lookup3.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+lookup3_prefix::lookup3_prefix(std::string_view value) : _value(value)
+{
+    const size_t prefix_blocks = _value.size() / 12;
+
+    _states.resize(uploaded_string::max_length + 1);
+    _blocks.resize(uploaded_string::max_length + 1);
+
+    // The prefix might not be 4-byte aligned in memory.
+    std::vector<uint32_t> words(prefix_blocks * 3);
+    memcpy(words.data(), _value.data(), words.size() * sizeof(uint32_t));
+
+    for (size_t length = 0; length <= uploaded_string::max_length; ++length) {
+        // Only the blocks hashlittle() mixes itself; see hashlittle_blocks().
+        size_t blocks = length == 0 ? 0 : std::min(prefix_blocks, (length - 1) / 12);
+
+        lookup3_state& state = _states[length];
+        state.a = state.b = state.c = 0xdeadbeef + uint32_t(length);
+        hashlittle_blocks(words.data(), blocks, &state.a, &state.b, &state.c);
+
+        _blocks[length] = uint32_t(blocks);
+    }
+}
+
+uint32_t lookup3_prefix::seed(uploaded_string const& element, lookup3_state& state) const
+{
+    size_t length = element.value().size();
+
+    state = _states[length];
+    return _blocks[length];
+}
+
+uint32_t lookup3_seed(lookup3_prefix const* prefix, uploaded_string const& element, lookup3_state& state)
+{
+    if (prefix != nullptr)
+        return prefix->seed(element, state);
+
+    state.a = state.b = state.c = 0xdeadbeef + uint32_t(element.value().size());
+    return 0;
+}
+
+void lookup3_run_seeder::reset(std::vector<prefix_run> const& runs)
+{
+    _runs = &runs;
+    _current = runs.size();
+    _begin = _end = 0;
+}
+
+void lookup3_run_seeder::enter(size_t index)
+{
+    std::vector<prefix_run> const& runs = *_runs;
+
+    // Strings are mostly seeded in order, one run after the other.
+    if (_current + 1 < runs.size() && index >= runs[_current + 1].begin && index < runs[_current + 1].end)
+        ++_current;
+    else {
+        auto run = std::upper_bound(runs.begin(), runs.end(), index, [](size_t index, prefix_run const& run) {
+            return index < run.end;
+        });
+
+        _current = size_t(run - runs.begin());
+    }
+
+    _begin = runs[_current].begin;
+    _end = runs[_current].end;
+    _seeding = _end - _begin >= minimum_run && runs[_current].prefix.size() >= 12;
+    ++_run;
+    _copied = false;
+}
+
+void lookup3_run_seeder::compute(slot_t& slot, size_t length)
+{
+    if (!_copied) {
+        std::string_view head = (*_runs)[_current].prefix;
+
+        _words.resize(head.size() / 12 * 3);
+        memcpy(_words.data(), head.data(), _words.size() * sizeof(uint32_t));
+        _copied = true;
+    }
+
+    // The head may cover the last block of the value, which is left to the kernel's tail.
+    slot.blocks = length == 0 ? 0 : uint32_t(std::min(_words.size() / 3, (length - 1) / 12));
+    slot.state.a = slot.state.b = slot.state.c = 0xdeadbeef + uint32_t(length);
+    hashlittle_blocks(_words.data(), slot.blocks, &slot.state.a, &slot.state.b, &slot.state.c);
+}
+
+size_t lookup3_run_table::build(uploaded_string* data, size_t count, std::vector<prefix_run> const& runs, uint32_t* table)
+{
+    for (size_t i = 0; i < count; ++i)
+        data[i].set_hash(0);
+
+    uint32_t entries = 1;
+    for (prefix_run const& run : runs) {
+        // Heads under 12 bytes have no full block to skip.
+        if (run.prefix.size() < 12)
+            continue;
+
+        ++_run;
+        for (size_t i = run.begin; i < run.end; ++i) {
+            slot_t& slot = _slots[data[i].value().size()];
+            if (slot.run != _run) {
+                slot.run = _run;
+                slot.count = 0;
+                slot.entry = 0;
+            }
+
+            ++slot.count;
+        }
+
+        _words.resize(run.prefix.size() / 12 * 3);
+        memcpy(_words.data(), run.prefix.data(), _words.size() * sizeof(uint32_t));
+
+        for (size_t i = run.begin; i < run.end; ++i) {
+            size_t length = data[i].value().size();
+
+            slot_t& slot = _slots[length];
+            if (slot.count < 2)
+                continue;
+
+            if (slot.entry == 0) {
+                // The head may cover the last block of the value, which is left to the shader.
+                uint32_t blocks = length == 0 ? 0 : uint32_t(std::min(_words.size() / 3, (length - 1) / 12));
+                if (blocks == 0) {
+                    slot.count = 0;
+                    continue;
+                }
+
+                lookup3_state state;
+                state.a = state.b = state.c = 0xdeadbeef + uint32_t(length);
+                hashlittle_blocks(_words.data(), blocks, &state.a, &state.b, &state.c);
+
+                uint32_t* entry = table + entries * 4;
+                entry[0] = state.a;
+                entry[1] = state.b;
+                entry[2] = state.c;
+                entry[3] = blocks;
+
+                slot.entry = entries++;
+            }
+
+            data[i].set_hash(slot.entry);
+        }
+    }
+
+    return entries * 4;
+}
+
+lookup3_kernel hashlittle_batch_kernel()
+{
+    static const lookup3_kernel kernel = []() {
+        if (cpu_features::avx512())
+            return lookup3_kernel::avx512;
+
+        if (cpu_features::avx2())
+            return lookup3_kernel::avx2;
+
+        return lookup3_kernel::scalar;
+    }();
+
+    return kernel;
+}
+
+bool hashlittle_batch_supported(lookup3_kernel kernel)
+{
+    switch (kernel) {
+        case lookup3_kernel::avx512:
+            return cpu_features::avx512();
+        case lookup3_kernel::avx2:
+            return cpu_features::avx2();
+        case lookup3_kernel::scalar:
+        default:
+            return true;
+    }
+}
+
+const char* to_string(lookup3_kernel kernel)
+{
+    switch (kernel) {
+        case lookup3_kernel::avx512:
+            return "AVX-512 (16 lanes)";
+        case lookup3_kernel::avx2:
+            return "AVX2 (8 lanes)";
+        case lookup3_kernel::scalar:
+        default:
+            return "scalar";
+    }
+}
+
+void hashlittle_batch(uploaded_string* data, size_t count, lookup3_seeds seeds)
+{
+    hashlittle_batch(data, count, hashlittle_batch_kernel(), seeds);
+}
+
+void hashlittle_batch(uploaded_string* data, size_t count, lookup3_kernel kernel, lookup3_seeds seeds)
+{
+    switch (kernel) {
+        case lookup3_kernel::avx512:
+            hashlittle_batch_avx512(data, count, seeds);
+            break;
+        case lookup3_kernel::avx2:
+            hashlittle_batch_avx2(data, count, seeds);
+            break;
+        case lookup3_kernel::scalar:
+        default:
+            hashlittle_batch_scalar(data, count, seeds);
+            break;
+    }
+}
+
+void hashlittle_batch_scalar(uploaded_string* data, size_t count, lookup3_seeds seeds)
+{
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view key = data[i].value();
+
+        lookup3_state state;
+        uint32_t blocks = seeds.seed(i, data[i], state);
+
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(key.data()) + blocks * 3;
+        data[i].set_hash(hashlittle_tail(words, key.size() - blocks * 12, state.a, state.b, state.c));
+    }
+}
+
+void hashlittle_packed(packed_strings& batch, size_t begin, size_t end)
+{
+    // Strings start on a word boundary, so the aligned path of hashlittle() applies; it never
+    // reads past the last word of a string.
+    for (size_t i = begin; i < end; ++i)
+        batch.set_hash(i, hashlittle(batch.words(i), batch.value(i).size(), 0));
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "uploaded_string.hpp"
+#include "packed_strings.hpp"
+
+// Batched hashlittle() over uploaded_string records.
+// Every kernel produces results bit-identical to hashlittle(words, char_count, 0) and stores them
+// in the record's hash field, exactly like the compute shader does.
+enum class lookup3_kernel {
+    scalar,
+    avx2,
+    avx512,
+};
+
+// Internal (a, b, c) state of lookup3.
+struct lookup3_state {
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t c = 0;
+};
+
+// Midstates of the constant leading bytes of a pattern.
+// Every candidate of a pattern such as 'INTERFACE/ICONS/[alnum]{4}.BLP' starts with the same
+// bytes; the state hashlittle() reaches after the full 12-byte blocks of that prefix only has to
+// be computed once per pattern (and per key length, since the initial state depends on it).
+class lookup3_prefix {
+public:
+    lookup3_prefix() = default;
+    explicit lookup3_prefix(std::string_view value);
+
+    std::string_view value() const { return _value; }
+
+    // Loads into state the lookup3 state after the leading blocks of element this prefix covers,
+    // and returns how many blocks that is. element must start with the prefix; this is not checked.
+    uint32_t seed(uploaded_string const& element, lookup3_state& state) const;
+
+private:
+    std::string _value;
+
+    // Both indexed by key length.
+    std::vector<lookup3_state> _states;
+    std::vector<uint32_t> _blocks;
+};
+
+// Same as lookup3_prefix::seed, with no prefix at all when prefix is null.
+uint32_t lookup3_seed(lookup3_prefix const* prefix, uploaded_string const& element, lookup3_state& state);
+
+// Strings [begin, end) of a frame, which all start with prefix.
+struct prefix_run {
+    size_t begin = 0;
+    size_t end = 0;
+    std::string prefix;
+};
+
+// Midstates of the strings of runs that share a head, such as every file of a directory in
+// '{dirs}/{files}'. The initial state of lookup3 depends on the key length, so a midstate is computed
+// per run and length, once enough strings of that length came up in the run.
+// Meant to be used by a single thread, which must seed strings in order.
+// The GPU backend uploads the midstates of runs instead; see lookup3_run_table.
+class lookup3_run_seeder {
+public:
+    lookup3_run_seeder() : _slots(uploaded_string::max_length + 1) { }
+
+    // Seeds strings from runs, which must cover every index passed to seed() and stay alive until
+    // the next call.
+    void reset(std::vector<prefix_run> const& runs);
+
+    // Same as lookup3_prefix::seed, for the string at index of the frame runs cover.
+    uint32_t seed(size_t index, uploaded_string const& element, lookup3_state& state) {
+        if (index < _begin || index >= _end)
+            enter(index);
+
+        if (!_seeding)
+            return lookup3_seed(nullptr, element, state);
+
+        slot_t& slot = _slots[element.value().size()];
+        if (slot.run != _run) {
+            slot.run = _run;
+            slot.count = 0;
+        }
+
+        if (slot.count < reuse_threshold) {
+            if (++slot.count < reuse_threshold)
+                return lookup3_seed(nullptr, element, state);
+
+            compute(slot, element.value().size());
+        }
+
+        state = slot.state;
+        return slot.blocks;
+    }
+
+private:
+    // Midstate of the current run for a key length, if computed since the run started.
+    struct slot_t {
+        uint64_t run = 0;
+        uint32_t count = 0;
+        lookup3_state state;
+        uint32_t blocks = 0;
+    };
+
+    // Strings of a length a midstate is computed at, and strings a run needs to be seeded at all.
+    // A midstate costs as much as hashing the blocks it covers, but on a single lane, and lanes
+    // resuming from different blocks slow the vector kernels down: on runs of 32 to 128 strings
+    // under 32 to 52 byte heads, seeding gains 10 to 18% when the strings mostly share a length,
+    // and loses about 6% when their lengths are spread out.
+    static constexpr uint32_t reuse_threshold = 8;
+    static constexpr size_t minimum_run = 32;
+
+    std::vector<prefix_run> const* _runs = nullptr;
+
+    // The run strings are being seeded from, and its range.
+    size_t _current = 0;
+    size_t _begin = 0;
+    size_t _end = 0;
+    bool _seeding = false;
+
+    // Incremented with every run, so that slots do not have to be cleared.
+    uint64_t _run = 0;
+    std::vector<slot_t> _slots;
+
+    // Full blocks of the head of the current run, copied once a midstate is needed; it might not
+    // be 4-byte aligned in memory.
+    std::vector<uint32_t> _words;
+    bool _copied = false;
+
+    // Moves to the run of the string at index.
+    void enter(size_t index);
+
+    // Computes the midstate of the current run for strings of length.
+    void compute(slot_t& slot, size_t length);
+};
+
+// Midstates of the runs of a frame as jenkins.comp, built with RUN_MIDSTATES, resumes from them: a
+// table of (a, b, c, blocks) entries, one per run and key length, and in the hash field of every
+// string the entry it resumes from, or 0. Entry 0 is never used.
+// A midstate is computed on the host for a length once two strings of the run have it; every other
+// string of that length then skips the blocks it covers on the device.
+class lookup3_run_table {
+public:
+    lookup3_run_table() : _slots(uploaded_string::max_length + 1) { }
+
+    // Size of the table for a frame of count strings, in words.
+    static size_t required_words(size_t count) {
+        return (count / 2 + 1) * 4;
+    }
+
+    // Fills table for the count strings of data, which runs must cover, and sets their hash field.
+    // Returns the number of words of table written.
+    size_t build(uploaded_string* data, size_t count, std::vector<prefix_run> const& runs, uint32_t* table);
+
+private:
+    // Strings of a length in the current run, and the entry computed for them if any.
+    struct slot_t {
+        uint64_t run = 0;
+        uint32_t count = 0;
+        uint32_t entry = 0;
+    };
+
+    // Incremented with every run, so that slots do not have to be cleared.
+    uint64_t _run = 0;
+    std::vector<slot_t> _slots;
+
+    // Full blocks of the head of the current run; it might not be 4-byte aligned in memory.
+    std::vector<uint32_t> _words;
+};
+
+// Where records resume hashing from: the midstates of a prefix they all start with, if any, or,
+// when runs is set, those of the run record i belongs to, i being counted from offset.
+struct lookup3_seeds {
+    lookup3_seeds(lookup3_prefix const* prefix = nullptr) : prefix(prefix) { }
+    explicit lookup3_seeds(lookup3_run_seeder* runs, size_t offset = 0) : runs(runs), offset(offset) { }
+
+    // Same as lookup3_prefix::seed, for the i-th record.
+    uint32_t seed(size_t i, uploaded_string const& element, lookup3_state& state) const {
+        if (runs != nullptr)
+            return runs->seed(offset + i, element, state);
+
+        return lookup3_seed(prefix, element, state);
+    }
+
+    // Seeds of the records from the n-th one on.
+    lookup3_seeds operator + (size_t n) const {
+        lookup3_seeds seeds = *this;
+        seeds.offset += n;
+        return seeds;
+    }
+
+    lookup3_prefix const* prefix = nullptr;
+    lookup3_run_seeder* runs = nullptr;
+    size_t offset = 0;
+};
+
+// Returns the fastest kernel supported by the CPU this runs on.
+lookup3_kernel hashlittle_batch_kernel();
+
+const char* to_string(lookup3_kernel kernel);
+
+// Hashes count records with the fastest kernel available.
+// Records resume hashing from the midstates seeds gives them; see lookup3_seeds.
+void hashlittle_batch(uploaded_string* data, size_t count, lookup3_seeds seeds = lookup3_seeds());
+
+// Hashes count records with the provided kernel. The caller is responsible for checking that the
+// CPU supports it.
+void hashlittle_batch(uploaded_string* data, size_t count, lookup3_kernel kernel, lookup3_seeds seeds = lookup3_seeds());
+
+// Hashes strings [begin, end) of a packed batch, storing results in its table.
+void hashlittle_packed(packed_strings& batch, size_t begin, size_t end);
+
+// Returns true if the CPU this runs on can execute the provided kernel.
+bool hashlittle_batch_supported(lookup3_kernel kernel);
+
+// Individual kernels; see lookup3_batch.cpp, lookup3_avx2.cpp and lookup3_avx512.cpp.
+void hashlittle_batch_scalar(uploaded_string* data, size_t count, lookup3_seeds seeds);
+void hashlittle_batch_avx2(uploaded_string* data, size_t count, lookup3_seeds seeds);
+void hashlittle_batch_avx512(uploaded_string* data, size_t count, lookup3_seeds seeds);
@@ -0,0 +1,28 @@
+#include "lookup3_incremental.hpp"
+#include "lookup3.hpp"
+
+#include <algorithm>
+
+uint32_t lookup3_incremental::hash(const uint32_t* words, size_t length, size_t unchanged)
+{
+    if (length != _length || _valid == 0) {
+        _length = length;
+        _states[0].a = _states[0].b = _states[0].c = 0xdeadbeef + uint32_t(length);
+        _valid = 1;
+    }
+
+    // See hashlittle_blocks() for the number of blocks mixed.
+    const size_t blocks = length == 0 ? 0 : (length - 1) / 12;
+
+    // _states[i] only depends on the first 12 * i bytes of the key.
+    size_t block = std::min(_valid - 1, unchanged / 12);
+    for (; block < blocks; ++block) {
+        lookup3_state state = _states[block];
+        hashlittle_blocks(words + block * 3, 1, &state.a, &state.b, &state.c);
+        _states[block + 1] = state;
+    }
+    _valid = blocks + 1;
+
+    lookup3_state const& state = _states[blocks];
+    return hashlittle_tail(words + blocks * 3, length - blocks * 12, state.a, state.b, state.c);
+}
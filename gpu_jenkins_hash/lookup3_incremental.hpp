@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "lookup3_batch.hpp"
+
+// hashlittle() over a sequence of keys that mostly share their leading bytes, such as the values
+// of a pattern enumerated in odometer order.
+// The state reached after every 12-byte block of the previous key is kept; hashing the next key
+// only re-mixes from the first block that contains a changed byte. Keys must be 4-byte aligned and
+// zero-padded to a whole block, like uploaded_string::words.
+class lookup3_incremental {
+public:
+    // Hashes the length bytes at words. The first unchanged bytes must be identical to those of
+    // the key last hashed by this object; pass 0 when that is not known.
+    uint32_t hash(const uint32_t* words, size_t length, size_t unchanged);
+
+    // Forgets the previous key.
+    void reset() { _valid = 0; }
+
+private:
+    // Length of the previous key; every state depends on it.
+    size_t _length = 0;
+
+    // Number of leading entries of _states that are still valid.
+    size_t _valid = 0;
+
+    // _states[i] is the state after mixing the first i blocks of the previous key.
+    lookup3_state _states[uploaded_string::max_length / 12 + 1];
+};
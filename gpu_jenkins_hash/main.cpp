@@ -5,14 +5,32 @@
 #include <string_view>
 #include <set>
 #include <array>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 #include "gpu_jenkins_hash.hpp"
+#include "cpu_jenkins_hash.hpp"
 #include "input_file.hpp"
 #include "uploaded_string.hpp"
 #include "metrics.hpp"
 #include "pattern.hpp"
 
 #include "lookup3.hpp"
+#include "lookup3_batch.hpp"
+#include "lookup3_incremental.hpp"
+#include "benchmark.hpp"
+#include "target_set.hpp"
+#include "pattern_descriptor.hpp"
+#include "length_buckets.hpp"
+#include "parallel_input.hpp"
+#include "checkpoint.hpp"
+#include "keyspace_plan.hpp"
+#include "wordlist.hpp"
 
 struct options_t {
 private:
@@ -55,40 +73,173 @@ public:
 
 JenkinsGpuHash app;
 
+// Set by Ctrl+C while checkpointing: data providers stop filling frames, so that the run winds
+// down with every frame in flight handled, and a final checkpoint is saved.
+std::atomic<bool> interrupted{ false };
+
+void onInterrupt(int) {
+    interrupted = true;
+}
+
+template <typename Engine, typename Provider, typename Handler>
+bool run_engine(Engine& engine, Provider& provider, Handler& handler) {
+    engine.setDataProvider(provider);
+    engine.setOutputHandler(handler);
+
+    try {
+        engine.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     options_t options(argv, argv + argc); //-V104
 
-    // --frames denotes the amount of frames of data pushed to the GPU
-    // while it is already calculating. This is similar to triple buffering in graphics.
-    app = JenkinsGpuHash(options.get("--frames", 3));
-    VkPhysicalDeviceLimits const& limits = app.getDeviceProperties().limits;
+    // --backend cpu never touches Vulkan, which makes it usable on machines without a suitable GPU.
+    bool cpuBackend = options.getString("--backend") == "cpu";
+
+    // The benchmark only exercises CPU kernels; don't bother initializing Vulkan for it.
+    if (options.has("--benchmark")) {
+        benchmark::hash_kernels(options.get("--frameSize", 65536), options.get("--iterations", 50));
+        benchmark::enumeration();
+        benchmark::generators(options.get("--frameSize", 65536));
+        return EXIT_SUCCESS;
+    }
+
+    // Wordlists are converted once, ahead of the runs that use them; see wordlist.
+    if (options.has("--convertWordlist")) {
+        std::string from(options.getString("--convertWordlist"));
+        std::string to(options.has("--wordlistOutput") ? options.getString("--wordlistOutput")
+            : std::filesystem::path(from).replace_extension(".bin").string());
 
-    std::atexit([]() {
-        app.cleanup();
-    });
+        try {
+            wordlist::convert(from, to);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (!cpuBackend) {
+        // --frames denotes the amount of frames of data pushed to the GPU
+        // while it is already calculating. This is similar to triple buffering in graphics.
+        app = JenkinsGpuHash(options.get("--frames", 3));
+
+        std::atexit([]() {
+            app.cleanup();
+        });
+    }
 
     if (options.has("--help") || !options.has("--input")) {
         std::cout
             << "Arguments:" << std::endl;
         std::cout
             << "--input             The path to the input file. This parameter is mandatory.\n\n";
+        std::cout
+            << "--backend           Either 'gpu' or 'cpu'. The CPU backend hashes on a pool of worker threads and\n"
+            << "                    does not initialize Vulkan at all.\n"
+            << "                    The default value is 'gpu'.\n\n";
         std::cout
             << "--frames            This parameter is similar to buffering and allows the application\n"
             << "                    to enqueue work on the GPU without waiting for hash computations to finish.\n"
             << "                    The default value is 3.\n\n";
+
+        if (cpuBackend) {
+            std::cout
+                << "--threads           The number of worker threads used by the CPU backend.\n"
+                << "                    The default value is the number of hardware threads (" << std::thread::hardware_concurrency() << " on your system).\n\n";
+            std::cout
+                << "--frameSize         The number of strings hashed per frame by the CPU backend.\n"
+                << "                    The default value is 65536.\n\n";
+            std::cout
+                << "--incremental       Hashes values as they are enumerated, re-mixing only the 12-byte blocks that\n"
+                << "                    changed since the previous value, instead of handing frames to the worker threads.\n"
+                << "                    This is a boolean flag, it doesn't require a value.\n\n";
+        }
+        else {
+            VkPhysicalDeviceLimits const& limits = app.getDeviceProperties().limits;
+
+            std::cout
+                << "--workgroupCount    This parameter defines the number of workgroups that can be dispatched at once.\n"
+                << "                    The default value is '3,1,1'.\n\n"
+                << "                    This value should not exceed '" << limits.maxComputeWorkGroupCount[0] << ","
+                                                                        << limits.maxComputeWorkGroupCount[1] << ","
+                                                                        << limits.maxComputeWorkGroupCount[2] << "' on your system.\n\n";
+            std::cout
+                << "--workgroupSize     This parameter defines the amount of work each workgroup can process.\n"
+                << "                    The default value is '64,64,64', which is the bare minimum for any kind of performance benefit.\n\n"
+                << "                    This value should not exceed '" << limits.maxComputeWorkGroupSize[0] << ","
+                                                                        << limits.maxComputeWorkGroupSize[1] << ","
+                                                                        << limits.maxComputeWorkGroupSize[2] << "' on your system.\n\n"
+                << "                    These values multiplied should also not exceed " << limits.maxComputeWorkGroupInvocations << " on your system.\n\n";
+            std::cout
+                << "--generate          Builds candidates on the device from each pattern of the input file instead of uploading\n"
+                << "                    them, so that only the index of the first candidate of a frame crosses the bus.\n"
+                << "                    Each pattern, with the words of its wordlists, must fit in 64 KiB; mangled wordlists\n"
+                << "                    are not supported. Requires --targets. This is a boolean flag, it doesn't require a value.\n\n";
+            std::cout
+                << "--pipelined         Fills, submits and reads back frames on three separate threads, so that candidates are\n"
+                << "                    prepared and results checked while the device hashes other frames.\n"
+                << "                    This is a boolean flag, it doesn't require a value.\n\n";
+        }
+        std::cout
+            << "--dedupe            Reads the whole input file up front and skips or rewrites patterns whose values other\n"
+            << "                    patterns of the file already produce, so that each value is only hashed once. Only\n"
+            << "                    overlaps visible node by node are found. This is a boolean flag, it doesn't require a value.\n\n";
+        std::cout
+            << "--shard             Given as k/N: only hashes the k-th of N slices of the values of the whole input file, k going\n"
+            << "                    from 1 to N. Slices are cut by number of values, not by line, differ by at most one value, and\n"
+            << "                    together hold every value exactly once, so that N machines can share a file.\n\n";
         std::cout
-            << "--workgroupCount    This parameter defines the number of workgroups that can be dispatched at once.\n"
-            << "                    The default value is '3,1,1'.\n\n"
-            << "                    This value should not exceed '" << limits.maxComputeWorkGroupCount[0] << ","
-                                                                    << limits.maxComputeWorkGroupCount[1] << ","
-                                                                    << limits.maxComputeWorkGroupCount[2] << "' on your system.\n\n";
+            << "--plan              Reads the whole input file and prints the exact number of values of every pattern and of\n"
+            << "                    the whole file, then how long hashing them would take, estimated from --planSeconds seconds\n"
+            << "                    (default 3) of hashing values of every pattern on the selected backend, and exits. Honours\n"
+            << "                    --dedupe and --shard. This is a boolean flag, it doesn't require a value.\n\n";
         std::cout
-            << "--workgroupSize     This parameter defines the amount of work each workgroup can process.\n"
-            << "                    The default value is '64,64,64', which is the bare minimum for any kind of performance benefit.\n\n"
-            << "                    This value should not exceed '" << limits.maxComputeWorkGroupSize[0] << ","
-                                                                    << limits.maxComputeWorkGroupSize[1] << ","
-                                                                    << limits.maxComputeWorkGroupSize[2] << "' on your system.\n\n"
-            << "                    These values multiplied should also not exceed " << limits.maxComputeWorkGroupInvocations << " on your system.\n\n";
+            << "--convertWordlist   Path of a wordlist, one word per line, to convert to a binary file that {file} nodes of\n"
+            << "                    patterns open instantly: words normalized, grouped by length (shortest first) and padded to\n"
+            << "                    4 bytes. The binary file goes to --wordlistOutput, by default the same path with a .bin\n"
+            << "                    extension, and the application exits.\n\n";
+        std::cout
+            << "--checkpoint        Path of a file progress is saved to every --checkpointInterval seconds (default 60), and\n"
+            << "                    when the run is interrupted with Ctrl+C, which then stops once the frames in flight are\n"
+            << "                    handled. Cannot be combined with --bucketLengths.\n\n";
+        std::cout
+            << "--resume            Path of a checkpoint to pick a run up from; the input file, --dedupe and --shard must be the\n"
+            << "                    same as in the run that wrote it. Progress keeps being saved to it, unless --checkpoint says otherwise.\n\n";
+        std::cout
+            << "--hits              Path of a file matches are appended to, one per line. When resuming, matches found after\n"
+            << "                    the checkpoint was saved are removed from it first.\n\n";
+        std::cout
+            << "--packed            Uploads strings as a table of offsets and lengths followed by their characters,\n"
+            << "                    instead of as fixed-size records of " << uploaded_string::max_length << " characters. This is a boolean flag,\n"
+            << "                    it doesn't require a value.\n\n";
+        std::cout
+            << "--fillThreads       The number of threads writing candidates into each frame, each one enumerating its own range\n"
+            << "                    of the current pattern. Ignored with --packed, --bucketLengths and --incremental.\n"
+            << "                    The default value is 1.\n\n";
+        std::cout
+            << "--bucketLengths     Holds strings back and regroups them by length, so that every frame only holds strings\n"
+            << "                    that take the same number of rounds to hash. Ignored with --packed. This is a boolean flag,\n"
+            << "                    it doesn't require a value.\n\n";
+        std::cout
+            << "--benchmark         Times the CPU batch hash kernels supported by this machine (scalar, AVX2, AVX-512)\n"
+            << "                    on synthetic frames of --frameSize strings, --iterations times (default 50), then compares\n"
+            << "                    full and incremental hashing of a few enumerated patterns, and generic and specialized\n"
+            << "                    enumeration of the pattern shapes pattern_generators knows about, and exits.\n\n";
+        std::cout
+            << "--targets           Comma-separated list of files holding the hashes to resolve, one hexadecimal hash per line.\n"
+            << "                    Only candidates whose hash appears in one of them are reported, along with the names of the\n"
+            << "                    lists they were found in. On the GPU, matching happens on the device and only the\n"
+            << "                    matches are read back, unless --validate is also given.\n\n";
         std::cout
             << "--validate          Performs checks of GPU-computed values against CPU-computed values. You generally do not want to run"
             << "                    with this flag, since it's going to kill your hash rate. This is a boolean flag, it doesn't require"
@@ -105,6 +256,144 @@ int main(int argc, char* argv[]) {
 
     input_file input(options.getString("--input").data());
 
+    // --dedupe skips or narrows down lines whose values other lines of the file already produce.
+    if (options.has("--dedupe"))
+        input.deduplicate();
+
+    // --shard k/N only enumerates the k-th of N equal slices of the values of the whole file, so
+    // that N machines can share it.
+    if (options.has("--shard")) {
+        std::string_view shard = options.getString("--shard");
+        size_t separator = shard.find('/');
+
+        uint32_t index = std::atoi(std::string(shard.substr(0, separator)).c_str());
+        uint32_t count = separator == std::string_view::npos ? 0 : std::atoi(std::string(shard.substr(separator + 1)).c_str());
+
+        try {
+            if (index == 0)
+                throw std::runtime_error("Invalid shard '" + std::string(shard) + "'; expected k/N, with k from 1 to N");
+
+            input.shard(index - 1, count);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --plan counts the values of every line and times a short run over samples of them instead
+    // of hashing the file; see keyspace_plan.
+    std::unique_ptr<keyspace_plan> plan;
+    if (options.has("--plan")) {
+        if (options.has("--checkpoint") || options.has("--resume")) {
+            std::cerr << "--plan cannot be combined with --checkpoint or --resume." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        plan = std::make_unique<keyspace_plan>(input, std::chrono::seconds(options.get("--planSeconds", 3)));
+    }
+
+    auto planProvider = [&plan](uploaded_string* data, size_t capacity) -> size_t {
+        return plan->fill(data, capacity);
+    };
+
+    auto planHandler = [](uploaded_string*, size_t) -> void { };
+
+    // --resume skips the values a checkpoint records as hashed; see checkpoint_t.
+    checkpoint_t progress;
+    progress.input = std::string(options.getString("--input"));
+    progress.deduplicated = options.has("--dedupe");
+    progress.shard = std::string(options.getString("--shard"));
+
+    if (options.has("--resume")) {
+        try {
+            checkpoint_t saved = checkpoint_t::load(std::string(options.getString("--resume")));
+            if (saved.input != progress.input || saved.deduplicated != progress.deduplicated || saved.shard != progress.shard)
+                throw std::runtime_error("Checkpoint was written for input '" + saved.input + "'" + (saved.deduplicated ? " with --dedupe" : "")
+                    + (saved.shard.empty() ? "" : " with --shard " + saved.shard));
+
+            progress = std::move(saved);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        input.seek(progress.position);
+
+        std::cout << ">> Resuming at value " << progress.position.index << " of pattern " << progress.position.pattern
+            << " (" << progress.hashed << " values hashed and " << progress.matches << " matches found so far)." << std::endl;
+    }
+
+    // --hits appends matches to a file; on resume, matches found past the checkpoint are dropped
+    // from it, since their frames are hashed again. A fresh run starts checkpointing from the size
+    // the log already has, so that resuming it never drops matches of earlier runs.
+    std::ofstream hitLog;
+    uint64_t hitLogSize = 0;
+    if (options.has("--hits")) {
+        std::filesystem::path path(options.getString("--hits"));
+
+        std::error_code error;
+        hitLogSize = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+        if (!options.has("--resume"))
+            progress.hits_offset = hitLogSize;
+        else if (hitLogSize > progress.hits_offset) {
+            std::filesystem::resize_file(path, progress.hits_offset, error);
+            hitLogSize = progress.hits_offset;
+        }
+
+        hitLog.open(path, std::ios::app | std::ios::binary);
+        if (!hitLog.is_open()) {
+            std::cerr << "Failed to open hit log " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    target_set targets;
+    if (options.has("--targets")) {
+        try {
+            std::string_view lists = options.getString("--targets");
+            while (!lists.empty()) {
+                size_t separator = lists.find(',');
+                targets.load(std::string(lists.substr(0, separator)));
+
+                lists = separator == std::string_view::npos ? std::string_view() : lists.substr(separator + 1);
+            }
+
+            targets.build();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << ">> Loaded " << targets.size() << " target hashes from " << targets.list_count() << " lists." << std::endl;
+    }
+
+    // Candidates can only be generated on the device if nothing but matches has to be read back.
+    // --plan calibrates with uploaded frames in any case.
+    const bool generating = !cpuBackend && options.has("--generate") && !plan;
+    if (generating && targets.empty()) {
+        std::cerr << "--generate requires --targets." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Every pattern is encoded once up front, so that one the device cannot take stops the run
+    // before it starts rather than halfway through the file.
+    if (generating) {
+        try {
+            input_file patterns(options.getString("--input").data());
+
+            pattern_range range;
+            while (patterns.nextPattern(range))
+                pattern_descriptor descriptor(range.pattern);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     std::function<std::array<uint32_t, 3>(std::string_view, std::array<std::uint32_t, 3>)> workgroupParser = [](std::string_view v, std::array<uint32_t, 3> def) -> std::array<uint32_t, 3> {
         std::array<uint32_t, 3> sizes;
         size_t ofs = 0;
@@ -120,102 +409,384 @@ int main(int argc, char* argv[]) {
         return sizes;
     };
 
-    std::array<uint32_t, 3> workgroupSize = options.get("--workgroupSize", workgroupParser, { 64, 1, 1 });
-    std::array<uint32_t, 3> workgroupCount = options.get("--workgroupCount", workgroupParser, { 3, 1, 1 });
-
-    app.setWorkgroupSize(workgroupSize[0], workgroupSize[1], workgroupSize[2]);
-    app.setWorkgroupCount(workgroupCount[0], workgroupCount[1], workgroupCount[2]);
-
-    std::cout << "Running on: " << app.getDeviceProperties().deviceName << " (API Version "
-        << VK_VERSION_MAJOR(app.getDeviceProperties().apiVersion) << "."
-        << VK_VERSION_MINOR(app.getDeviceProperties().apiVersion) << "."
-        << VK_VERSION_PATCH(app.getDeviceProperties().apiVersion) << ") (Driver Version "
-        << VK_VERSION_MAJOR(app.getDeviceProperties().driverVersion) << "."
-        << VK_VERSION_MINOR(app.getDeviceProperties().driverVersion) << "."
-        << VK_VERSION_PATCH(app.getDeviceProperties().driverVersion) << ")" << std::endl;
-
-    // The maximum number of local workgroups that can be dispatched by a single dispatch command.
-    // These three values represent the maximum number of local workgroups for the X, Y, and Z dimensions, respectively.
-    // The workgroup count parameters to the dispatch commands must be less than or equal to the corresponding limit.
-    std::cout << "    maxComputeWorkGroupCount: { "
-        << limits.maxComputeWorkGroupCount[0] << ", "
-        << limits.maxComputeWorkGroupCount[1] << ", "
-        << limits.maxComputeWorkGroupCount[2] << " }" << std::endl;
-
-    // The maximum total number of compute shader invocations in a single local workgroup.
-    // The product of the X, Y, and Z sizes as specified by the LocalSize execution mode in shader modules and by the
-    // object decorated by the WorkgroupSize decoration must be less than or equal to this limit.
-    std::cout << "    maxComputeWorkGroupSize: { "
-        << limits.maxComputeWorkGroupSize[0] << ", "
-        << limits.maxComputeWorkGroupSize[1] << ", "
-        << limits.maxComputeWorkGroupSize[2] << " }" << std::endl;
-
-    // The maximum total number of compute shader invocations in a single local workgroup.
-    // The product of the X, Y, and Z sizes as specified by the LocalSize execution mode in shader modules and by the object
-    // decorated by the WorkgroupSize decoration must be less than or equal to this limit.
-    std::cout << "    maxComputeWorkGroupInvocations: "
-        << limits.maxComputeWorkGroupInvocations << std::endl;
-
-    // Specifies support for timestamps on all graphics and compute queues.
-    // If this limit is set to VK_TRUE, all queues that advertise the VK_QUEUE_GRAPHICS_BIT or VK_QUEUE_COMPUTE_BIT in the
-    // VkQueueFamilyProperties::queueFlags support VkQueueFamilyProperties::timestampValidBits of at least 36.
-    std::cout << "    timestampComputeAndGraphics: " << (limits.timestampComputeAndGraphics ? "yes" : "no") << std::endl;
-
-    std::cout << "\n\n";
-
-    std::cout << "Hardware limits applied to user-defined configuration...\n";
-    std::cout << "\n>> Workgroup count: { " << app.getParams().workgroupCount[0] << ", " << app.getParams().workgroupCount[1] << ", " << app.getParams().workgroupCount[2] << " }";
-    std::cout << "\n>> Workgroup sizes: { " << app.getParams().workgroupSize[0] << ", " << app.getParams().workgroupSize[1] << ", " << app.getParams().workgroupSize[2] << " }";
-    std::cout << "\n>> Number of lookahead frames: " << app.getFrameCount();
-
-    std::cout << std::endl;
-
-    app.setDataProvider([&input](uploaded_string* data, size_t capacity) -> size_t {
-        size_t i = 0;
-
-        memset(data, 0, sizeof(uploaded_string) * capacity);
-        for (; i < capacity && input.hasNext(); ++i) {
-
-            uploaded_string& element = *data;
-            if (!input.next(element))
-                break;
+    // With --checkpoint, every frame filled is recorded along with the position of the input
+    // after it; see checkpoint_writer.
+    std::unique_ptr<checkpoint_writer> checkpoints;
+    auto track = [&checkpoints](input_position const& position, size_t count) -> size_t {
+        if (checkpoints && count != 0)
+            checkpoints->produced(position, count);
 
-            ++data;
-        }
+        return count;
+    };
+
+    // Records only ever hold values written by the engines or by pattern_t, which keep every byte
+    // past the end of a value zeroed; only the records left unused need clearing.
+    auto dataProvider = [&input, &track](uploaded_string* data, size_t capacity) -> size_t {
+        size_t count = interrupted ? 0 : input.next(data, capacity);
+
+        memset(data + count, 0, sizeof(uploaded_string) * (capacity - count));
+        return track(input.position(), count);
+    };
 
-        return i;
-    });
+    // On the GPU, hashes are matched against targets on the device and only matches are read back.
+    const bool deviceFiltering = !cpuBackend && !targets.empty() && (generating || !options.has("--validate"));
 
     size_t output = 0;
+    size_t matches = size_t(progress.matches);
     std::vector<std::string> failed_hashes;
-    app.setOutputHandler([&output, &options, &failed_hashes](uploaded_string* data, size_t count) -> void {
-        if (options.has("--validate"))
+    const bool validate = options.has("--validate");
+
+    // Shared by both batch formats.
+    auto handleResult = [&matches, &failed_hashes, &targets, &hitLog, &hitLogSize, validate](std::string_view value, uint32_t hash) -> void {
+        if (!targets.empty())
         {
-            for (size_t i = 0; i < count; ++i)
+            target_set::tag_mask lists = targets.find(hash);
+            if (lists != 0)
             {
-                uploaded_string& itr = data[i];
-
-                uint32_t gpuHash = itr.get_hash();
-                uint32_t cpuHash = itr.get_cpu_hash();
-                if (gpuHash != cpuHash)
-                    failed_hashes.push_back(std::string(itr.value()));
+                std::cout << ">> Match: " << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << hash
+                    << std::dec << std::nouppercase << std::setfill(' ') << " " << value << " (" << targets.list_names(lists) << ")" << std::endl;
+                ++matches;
+
+                // Flushed right away, so that checkpoints never refer to hits still in a buffer.
+                if (hitLog.is_open()) {
+                    std::ostringstream line;
+                    line << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << hash
+                        << " " << value << " (" << targets.list_names(lists) << ")\n";
+
+                    hitLog << line.str() << std::flush;
+                    hitLogSize += line.str().size();
+                }
             }
         }
 
+        if (validate)
+        {
+            uint32_t cpuHash = hashlittle(value.data(), value.size(), 0);
+            if (hash != cpuHash)
+                failed_hashes.push_back(std::string(value));
+        }
+    };
+
+    auto outputHandler = [&output, &matches, &hitLogSize, &checkpoints, &handleResult](uploaded_string* data, size_t count) -> void {
+        for (size_t i = 0; i < count; ++i)
+            handleResult(data[i].value(), data[i].get_hash());
+
         output += count;
-    });
 
-    try {
-        app.run();
+        if (checkpoints)
+            checkpoints->consumed(matches, hitLogSize);
+    };
+
+    // --packed uploads variable-length batches instead of fixed-size records; see packed_strings.
+    const bool packed = options.has("--packed");
+
+    auto packedProvider = [&input, &track](packed_strings& batch) -> size_t {
+        while (!interrupted && input.hasNext() && input.next(batch))
+            ;
+
+        return track(input.position(), batch.size());
+    };
+
+    auto packedOutputHandler = [&output, &matches, &hitLogSize, &checkpoints, &handleResult](packed_strings const& batch) -> void {
+        for (size_t i = 0; i < batch.size(); ++i)
+            handleResult(batch.value(i), batch.hash(i));
+
+        output += batch.size();
+
+        if (checkpoints)
+            checkpoints->consumed(matches, hitLogSize);
+    };
+
+    // --bucketLengths sorts values into frames of a single length class; see length_buckets.
+    const bool bucketing = options.has("--bucketLengths") && !packed && !generating;
+
+    length_buckets buckets;
+    uint32_t lastLengthClass = 0;
+    auto bucketedProvider = [&input, &buckets, &lastLengthClass](uploaded_string* data, size_t capacity) -> size_t {
+        size_t count = buckets.fill(data, capacity, [&input](char* storage, size_t& length) -> bool {
+            return input.hasNext() && input.next(storage, length);
+        }, lastLengthClass);
+
+        memset(data + count, 0, sizeof(uploaded_string) * (capacity - count));
+        return count;
+    };
+
+    // --fillThreads splits the enumeration of every frame across threads; see parallel_input.
+    std::unique_ptr<parallel_input> parallelInput;
+    const uint32_t fillThreads = options.get("--fillThreads", 1);
+    if (fillThreads > 1 && !packed && !bucketing && !generating)
+        parallelInput = std::make_unique<parallel_input>(input, fillThreads);
+
+    auto parallelProvider = [&parallelInput, &track](uploaded_string* data, size_t capacity) -> size_t {
+        if (interrupted)
+            return 0;
+
+        size_t count = parallelInput->fill(data, capacity);
+        return track(parallelInput->position(), count);
+    };
+
+    // --checkpoint saves progress every --checkpointInterval seconds and when interrupted with
+    // Ctrl+C; --resume keeps saving to the checkpoint it started from unless told otherwise.
+    std::string checkpointPath(options.has("--checkpoint") ? options.getString("--checkpoint") : options.getString("--resume"));
+    if (!checkpointPath.empty()) {
+        // Values are held back across frames, so no frame boundary is a position in the input.
+        if (bucketing) {
+            std::cerr << "--checkpoint and --resume cannot be combined with --bucketLengths." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        checkpoints = std::make_unique<checkpoint_writer>(checkpointPath, progress, std::chrono::seconds(options.get("--checkpointInterval", 60)));
+        std::signal(SIGINT, onInterrupt);
     }
-    catch (const std::exception& e) {
-        std::cerr << e.what() << std::endl;
+
+    // Frames are filled one run of values sharing a head at a time, so that runs can
+    // resume hashing from the midstates of their head: every file of a directory in
+    // '{dirs}/{files}', or every value of a pattern with a constant prefix. The CPU backend
+    // seeds them with lookup3_run_seeder; the GPU backend uploads their midstates, see
+    // lookup3_run_table.
+    std::vector<prefix_run> runs;
+    auto runDataProvider = [&input, &track, &runs](uploaded_string* data, size_t capacity) -> size_t {
+        runs.clear();
+
+        size_t count = 0;
+        while (!interrupted && count < capacity) {
+            prefix_run run;
+            run.begin = count;
+
+            count += input.nextRun(data + count, capacity - count, run);
+            if (count == run.begin)
+                break;
+
+            run.end = count;
+            runs.push_back(std::move(run));
+        }
+
+        memset(data + count, 0, sizeof(uploaded_string) * (capacity - count));
+        return track(input.position(), count);
+    };
+
+    bool success = false;
+    if (cpuBackend) {
+        JenkinsCpuHash cpu(options.get("--frames", 3),
+            options.get("--threads", std::max(std::thread::hardware_concurrency(), 1u)),
+            options.get("--frameSize", 65536));
+
+        bool incremental = options.has("--incremental") && !packed && !bucketing && !plan;
+
+        if (incremental)
+            std::cout << "Running on: CPU (incremental hashing while enumerating)" << std::endl;
+        else
+            std::cout << "Running on: CPU (" << cpu.getThreadCount() << " worker threads, "
+                << to_string(hashlittle_batch_kernel()) << " kernel)" << std::endl;
+        std::cout << "\n>> Frame size: " << cpu.getFrameSize();
+        if (packed)
+            std::cout << "\n>> Packed batches";
+        else if (bucketing)
+            std::cout << "\n>> Frames bucketed by length";
+        else if (parallelInput && !incremental)
+            std::cout << "\n>> Fill threads: " << parallelInput->getThreadCount();
+        std::cout << "\n>> Number of lookahead frames: " << cpu.getFrameCount();
+        std::cout << std::endl;
+
+        if (plan) {
+            // Calibration always goes through plain frames.
+            success = run_engine(cpu, planProvider, planHandler);
+        }
+        else if (packed) {
+            cpu.setPackedDataProvider(packedProvider);
+            cpu.setPackedOutputHandler(packedOutputHandler);
+
+            success = run_engine(cpu, dataProvider, outputHandler);
+        }
+        else if (incremental) {
+            lookup3_incremental hasher;
+            auto hashingProvider = [&input, &hasher, &track](uploaded_string* data, size_t capacity) -> size_t {
+                if (interrupted)
+                    return 0;
+
+                size_t i = 0;
+                for (; i < capacity && input.hasNext(); ++i) {
+                    if (!input.next(data[i], hasher))
+                        break;
+                }
+
+                return track(input.position(), i);
+            };
+
+            cpu.setPrehashed(true);
+            success = run_engine(cpu, hashingProvider, outputHandler);
+        }
+        else if (bucketing) {
+            // Frames mix values of every pattern, so there is no shared prefix to resume from.
+            success = run_engine(cpu, bucketedProvider, outputHandler);
+        }
+        else if (parallelInput) {
+            cpu.setPrefixProvider([&parallelInput](std::string_view& prefix) -> size_t {
+                prefix = parallelInput->prefix();
+                return parallelInput->producedFromCurrent();
+            });
+
+            success = run_engine(cpu, parallelProvider, outputHandler);
+        }
+        else {
+            cpu.setRunProvider([&runs](std::vector<prefix_run>& frameRuns) {
+                frameRuns.swap(runs);
+            });
+
+            success = run_engine(cpu, runDataProvider, outputHandler);
+        }
+    }
+    else {
+        std::array<uint32_t, 3> workgroupSize = options.get("--workgroupSize", workgroupParser, { 64, 1, 1 });
+        std::array<uint32_t, 3> workgroupCount = options.get("--workgroupCount", workgroupParser, { 3, 1, 1 });
+
+        app.setWorkgroupSize(workgroupSize[0], workgroupSize[1], workgroupSize[2]);
+        app.setWorkgroupCount(workgroupCount[0], workgroupCount[1], workgroupCount[2]);
+
+        if (deviceFiltering)
+            app.setTargets(&targets);
+
+        app.setPipelined(options.has("--pipelined"));
+
+        // Patterns are handed over whole, and stepped through one frame at a time.
+        std::shared_ptr<const pattern_descriptor> pattern;
+        uint64_t nextIndex = 0;
+        uint64_t endIndex = 0;
+        if (generating) {
+            app.setGeneratorProvider([&input, &pattern, &nextIndex, &endIndex, &track](std::shared_ptr<const pattern_descriptor>& descriptor, uint64_t& base, size_t capacity) -> size_t {
+                if (interrupted)
+                    return 0;
+
+                while (!pattern || nextIndex == endIndex) {
+                    pattern_range range;
+                    if (!input.nextPattern(range))
+                        return 0;
+
+                    pattern = std::make_shared<const pattern_descriptor>(range.pattern);
+                    endIndex = std::min(range.end, pattern->count());
+                    nextIndex = std::min(range.first, endIndex);
+
+                    std::cout << ">> Loaded pattern '" << range.pattern << "' (" << pattern->count() << " possible values).\n";
+                }
+
+                descriptor = pattern;
+                base = nextIndex;
+
+                size_t count = size_t(std::min<uint64_t>(capacity, endIndex - nextIndex));
+                nextIndex += count;
+                return track(input_position{ input.patternsRead(), nextIndex }, count);
+            });
+        }
+
+        VkPhysicalDeviceLimits const& limits = app.getDeviceProperties().limits;
+
+        std::cout << "Running on: " << app.getDeviceProperties().deviceName << " (API Version "
+            << VK_VERSION_MAJOR(app.getDeviceProperties().apiVersion) << "."
+            << VK_VERSION_MINOR(app.getDeviceProperties().apiVersion) << "."
+            << VK_VERSION_PATCH(app.getDeviceProperties().apiVersion) << ") (Driver Version "
+            << VK_VERSION_MAJOR(app.getDeviceProperties().driverVersion) << "."
+            << VK_VERSION_MINOR(app.getDeviceProperties().driverVersion) << "."
+            << VK_VERSION_PATCH(app.getDeviceProperties().driverVersion) << ")" << std::endl;
+
+        // The maximum number of local workgroups that can be dispatched by a single dispatch command.
+        // These three values represent the maximum number of local workgroups for the X, Y, and Z dimensions, respectively.
+        // The workgroup count parameters to the dispatch commands must be less than or equal to the corresponding limit.
+        std::cout << "    maxComputeWorkGroupCount: { "
+            << limits.maxComputeWorkGroupCount[0] << ", "
+            << limits.maxComputeWorkGroupCount[1] << ", "
+            << limits.maxComputeWorkGroupCount[2] << " }" << std::endl;
+
+        // The maximum total number of compute shader invocations in a single local workgroup.
+        // The product of the X, Y, and Z sizes as specified by the LocalSize execution mode in shader modules and by the
+        // object decorated by the WorkgroupSize decoration must be less than or equal to this limit.
+        std::cout << "    maxComputeWorkGroupSize: { "
+            << limits.maxComputeWorkGroupSize[0] << ", "
+            << limits.maxComputeWorkGroupSize[1] << ", "
+            << limits.maxComputeWorkGroupSize[2] << " }" << std::endl;
+
+        // The maximum total number of compute shader invocations in a single local workgroup.
+        // The product of the X, Y, and Z sizes as specified by the LocalSize execution mode in shader modules and by the object
+        // decorated by the WorkgroupSize decoration must be less than or equal to this limit.
+        std::cout << "    maxComputeWorkGroupInvocations: "
+            << limits.maxComputeWorkGroupInvocations << std::endl;
+
+        // Specifies support for timestamps on all graphics and compute queues.
+        // If this limit is set to VK_TRUE, all queues that advertise the VK_QUEUE_GRAPHICS_BIT or VK_QUEUE_COMPUTE_BIT in the
+        // VkQueueFamilyProperties::queueFlags support VkQueueFamilyProperties::timestampValidBits of at least 36.
+        std::cout << "    timestampComputeAndGraphics: " << (limits.timestampComputeAndGraphics ? "yes" : "no") << std::endl;
+
+        std::cout << "\n\n";
+
+        std::cout << "Hardware limits applied to user-defined configuration...\n";
+        std::cout << "\n>> Workgroup count: { " << app.getParams().workgroupCount[0] << ", " << app.getParams().workgroupCount[1] << ", " << app.getParams().workgroupCount[2] << " }";
+        std::cout << "\n>> Workgroup sizes: { " << app.getParams().workgroupSize[0] << ", " << app.getParams().workgroupSize[1] << ", " << app.getParams().workgroupSize[2] << " }";
+        std::cout << "\n>> Number of lookahead frames: " << app.getFrameCount();
+        if (options.has("--pipelined"))
+            std::cout << "\n>> Pipelined frame loop";
+        if (plan)
+            std::cout << "\n>> Calibrating for --plan";
+        else if (generating)
+            std::cout << "\n>> Generating candidates on the device";
+        else if (packed) {
+            app.setPackedDataProvider(packedProvider);
+            app.setPackedOutputHandler(packedOutputHandler);
+
+            std::cout << "\n>> Packed batches";
+        }
+        else if (bucketing) {
+            app.setBlockCountProvider([&lastLengthClass]() -> int32_t {
+                return int32_t(lastLengthClass);
+            });
+
+            std::cout << "\n>> Frames bucketed by length";
+        }
+        else if (parallelInput)
+            std::cout << "\n>> Fill threads: " << parallelInput->getThreadCount();
+
+        std::cout << std::endl;
+
+        if (plan)
+            success = run_engine(app, planProvider, planHandler);
+        else if (bucketing)
+            success = run_engine(app, bucketedProvider, outputHandler);
+        else if (parallelInput)
+            success = run_engine(app, parallelProvider, outputHandler);
+        else if (packed || generating)
+            success = run_engine(app, dataProvider, outputHandler);
+        else {
+            app.setRunProvider([&runs](std::vector<prefix_run>& frameRuns) {
+                frameRuns.swap(runs);
+            });
+
+            success = run_engine(app, runDataProvider, outputHandler);
+        }
+    }
+
+    // Whatever stopped the run, every frame handled so far is accounted for.
+    if (checkpoints) {
+        try {
+            checkpoints->flush();
+            std::cout << ">> Checkpoint saved to '" << checkpointPath << "'";
+            if (interrupted)
+                std::cout << "; run again with --resume " << checkpointPath << " to pick up where this run stopped";
+            std::cout << "." << std::endl;
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    if (!success)
         return EXIT_FAILURE;
+
+    if (plan) {
+        plan->print(std::cout, metrics::hashes_per_second());
+        return EXIT_SUCCESS;
     }
 
 	std::cout << ">> RESULTS:" << std::endl;
 
-    if (failed_hashes.size() > 0 && options.has("--validate")) {
+    if (failed_hashes.size() > 0 && validate) {
         std::cout << "Examples of failed hashes: " << std::endl;
         for (auto&& itr : failed_hashes)
             std::cout << "[] " << itr << std::endl;
@@ -224,12 +795,15 @@ int main(int argc, char* argv[]) {
 
     std::cout << "Hash rate: "
         << std::dec << uint64_t(metrics::hashes_per_second()) << " hashes per second ("
-        << metrics::total() << " hashes expected, "
-        << output << " total, ";
-    if (options.has("--validate"))
+        << metrics::total() << " hashes expected, ";
+    if (!deviceFiltering)
+        std::cout << output << " total, ";
+    if (validate)
         std::cout << (output - failed_hashes.size()) << " correct, " << (failed_hashes.size()) << " wrong, ";
 
     std::cout << metrics::elapsed_time().c_str() << " s)" << std::endl;
+    if (!targets.empty())
+        std::cout << "Target hashes matched: " << matches << std::endl;
     std::cout << "Done! Press a key to exit" << std::endl;
 
     std::cin.get();
@@ -0,0 +1,475 @@
+#include "mangling_rules.hpp"
+#include "uploaded_string.hpp"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+namespace {
+    constexpr const uint32_t max_length = uint32_t(uploaded_string::max_length);
+
+    // Rule characters are hashed like those of literals and words.
+    char normalized(char c) {
+        return c == '/' ? '\\' : char(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    // Positions are 0-9, then A-Z for 10 to 35.
+    bool decode_position(char c, uint8_t& position) {
+        if (c >= '0' && c <= '9')
+            position = uint8_t(c - '0');
+        else if (c >= 'A' && c <= 'Z')
+            position = uint8_t(c - 'A' + 10);
+        else
+            return false;
+
+        return true;
+    }
+
+    // Words are processed 16 characters at a time. max_length is a multiple of 16, so that the
+    // last chunk of a word still lies within the room it has, past its end if need be.
+    static_assert(max_length % 16 == 0, "words are processed in chunks of 16 characters");
+
+    // Replaces every x of the length characters at value with y; characters past the end of the
+    // word may be replaced as well.
+    void replace_all(char* value, uint32_t length, char x, char y) {
+        const __m128i from = _mm_set1_epi8(x);
+        const __m128i to = _mm_set1_epi8(y);
+
+        for (uint32_t i = 0; i < length; i += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + i));
+            const __m128i match = _mm_cmpeq_epi8(chunk, from);
+
+            chunk = _mm_or_si128(_mm_andnot_si128(match, chunk), _mm_and_si128(match, to));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(value + i), chunk);
+        }
+    }
+
+    // Removes every x from the length characters at value; returns how many are left. Chunks
+    // without x are moved as a whole.
+    uint32_t remove_all(char* value, uint32_t length, char x) {
+        const __m128i needle = _mm_set1_epi8(x);
+
+        uint32_t write = 0;
+        for (uint32_t read = 0; read < length; read += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + read));
+            const uint32_t size = std::min<uint32_t>(16, length - read);
+            const uint32_t matches = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle))) & ((1u << size) - 1);
+
+            // write never passes read, so this only overwrites characters already read.
+            if (matches == 0) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(value + write), chunk);
+                write += size;
+                continue;
+            }
+
+            for (uint32_t i = 0; i < size; ++i)
+                if ((matches & (1u << i)) == 0)
+                    value[write++] = value[read + i];
+        }
+
+        return write;
+    }
+
+    // Calls f with every word of a batch and its length.
+    template <typename F>
+    void each(char* values, size_t stride, uint32_t* lengths, size_t count, F const& f) {
+        for (size_t i = 0; i < count; ++i)
+            f(values + i * stride, lengths[i]);
+    }
+}
+
+std::shared_ptr<const mangling_rules> mangling_rules::open(std::string const& path)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const mangling_rules>> loaded;
+
+    std::error_code error;
+    std::string key = std::filesystem::weakly_canonical(path, error).string();
+    if (error)
+        key = path;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<const mangling_rules> rules = loaded[key].lock();
+    if (!rules) {
+        rules = std::shared_ptr<const mangling_rules>(new mangling_rules(path));
+        loaded[key] = rules;
+    }
+
+    return rules;
+}
+
+mangling_rules::mangling_rules(std::string path) : _path(std::move(path))
+{
+    std::ifstream fs(_path);
+    if (!fs.is_open())
+        throw std::runtime_error("Failed to open rules '" + _path + "'");
+
+    std::set<std::string> seen;
+    size_t repeated = 0;
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(fs, line)) {
+        ++line_number;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        auto fail = [&](std::string const& reason) {
+            throw std::runtime_error("Rule '" + line + "' on line " + std::to_string(line_number) + " of '" + _path + "' " + reason);
+        };
+
+        size_t i = 0;
+        auto next_position = [&]() -> uint8_t {
+            uint8_t position = 0;
+            if (i >= line.size())
+                fail("is missing an argument");
+            if (!decode_position(line[i++], position))
+                fail("has an invalid position");
+
+            return position;
+        };
+        auto next_character = [&]() -> char {
+            if (i >= line.size())
+                fail("is missing an argument");
+
+            return normalized(line[i++]);
+        };
+
+        std::vector<function_t> functions;
+        while (i < line.size()) {
+            function_t function{ line[i++], 0, 0, 0, 0 };
+
+            switch (function.name) {
+            case ' ': case ':':
+            case 'l': case 'u': case 'c': case 'C': case 't': case 'E':
+                continue;
+            case 'T':
+                next_position();
+                continue;
+            case 'e':
+                next_character();
+                continue;
+            case 'r': case 'd': case 'f': case 'q':
+            case '[': case ']': case '{': case '}':
+            case 'k': case 'K':
+                break;
+            case '$': case '^': case '@':
+                function.x = next_character();
+                break;
+            case 'D': case '\'': case 'p':
+            case 'z': case 'Z': case 'y': case 'Y':
+                function.n = next_position();
+                break;
+            case 'x': case 'O': case '*':
+                function.n = next_position();
+                function.m = next_position();
+                break;
+            case 'i': case 'o':
+                function.n = next_position();
+                function.x = next_character();
+                break;
+            case 's':
+                function.x = next_character();
+                function.y = next_character();
+                break;
+            default:
+                fail(std::string("uses unsupported function '") + function.name + "'");
+            }
+
+            functions.push_back(function);
+        }
+
+        // function_t has no padding, so rules compare as their bytes.
+        std::string key(reinterpret_cast<const char*>(functions.data()), functions.size() * sizeof(function_t));
+        if (!seen.insert(std::move(key)).second) {
+            ++repeated;
+            continue;
+        }
+
+        _rules.emplace_back(uint32_t(_functions.size()), uint32_t(functions.size()));
+        _functions.insert(_functions.end(), functions.begin(), functions.end());
+    }
+
+    if (_rules.empty())
+        throw std::runtime_error("Rules '" + _path + "' hold no rules");
+
+    if (repeated != 0)
+        std::cerr << ">> Skipped " << repeated << " rules of '" << _path << "' that repeat earlier ones.\n";
+}
+
+uint32_t mangling_rules::resized(function_t const& function, uint32_t length)
+{
+    // Words that would grow too long are left as is.
+    auto grown = [length](uint64_t size) {
+        return size > max_length ? length : uint32_t(size);
+    };
+
+    const uint32_t n = function.n;
+    const uint32_t m = function.m;
+
+    switch (function.name) {
+    case '$': case '^':
+        return grown(uint64_t(length) + 1);
+    case 'd': case 'f': case 'q':
+        return grown(uint64_t(length) * 2);
+    case 'p':
+        return grown(uint64_t(length) * (n + 1));
+    case '[': case ']':
+        return length == 0 ? 0 : length - 1;
+    case 'D':
+        return n < length ? length - 1 : length;
+    case '\'':
+        return n < length ? n : length;
+    case 'x':
+        return n < length && n + m <= length ? m : length;
+    case 'O':
+        return n < length && n + m <= length ? length - m : length;
+    case 'i':
+        return n <= length ? grown(uint64_t(length) + 1) : length;
+    case 'z': case 'Z':
+        return length == 0 ? 0 : grown(uint64_t(length) + n);
+    case 'y': case 'Y':
+        return n <= length ? grown(uint64_t(length) + n) : length;
+    default:
+        return length;
+    }
+}
+
+void mangling_rules::apply(size_t rule, char* values, size_t stride, uint32_t* lengths, size_t count) const
+{
+    auto [first, size] = _rules[rule];
+
+    for (uint32_t f = first; f < first + size; ++f) {
+        function_t const& function = _functions[f];
+
+        const uint32_t n = function.n;
+        const uint32_t m = function.m;
+        const char x = function.x;
+        const char y = function.y;
+
+        // Runs body on every word that function changes the length of, with its new length.
+        auto resizing = [&](auto const& body) {
+            each(values, stride, lengths, count, [&](char* value, uint32_t& length) {
+                const uint32_t next = resized(function, length);
+                if (next != length) {
+                    body(value, length, next);
+                    length = next;
+                }
+            });
+        };
+
+        switch (function.name) {
+        case 'r':
+            each(values, stride, lengths, count, [](char* value, uint32_t& length) {
+                std::reverse(value, value + length);
+            });
+            break;
+        case 'd':
+            resizing([](char* value, uint32_t length, uint32_t) {
+                memcpy(value + length, value, length);
+            });
+            break;
+        case 'f':
+            resizing([](char* value, uint32_t length, uint32_t) {
+                std::reverse_copy(value, value + length, value + length);
+            });
+            break;
+        case 'p':
+            resizing([n](char* value, uint32_t length, uint32_t) {
+                for (uint32_t copy = 1; copy <= n; ++copy)
+                    memcpy(value + copy * length, value, length);
+            });
+            break;
+        case 'q':
+            resizing([](char* value, uint32_t length, uint32_t) {
+                // From the end, so that no character is overwritten before it is copied.
+                for (uint32_t i = length; i-- > 0; )
+                    value[2 * i] = value[2 * i + 1] = value[i];
+            });
+            break;
+        case '$':
+            resizing([x](char* value, uint32_t length, uint32_t) {
+                value[length] = x;
+            });
+            break;
+        case '^':
+            resizing([x](char* value, uint32_t length, uint32_t) {
+                memmove(value + 1, value, length);
+                value[0] = x;
+            });
+            break;
+        case '[':
+            resizing([](char* value, uint32_t length, uint32_t) {
+                memmove(value, value + 1, length - 1);
+            });
+            break;
+        case 'D':
+            resizing([n](char* value, uint32_t length, uint32_t) {
+                memmove(value + n, value + n + 1, length - n - 1);
+            });
+            break;
+        case 'x':
+            resizing([n, m](char* value, uint32_t, uint32_t) {
+                memmove(value, value + n, m);
+            });
+            break;
+        case 'O':
+            resizing([n, m](char* value, uint32_t length, uint32_t) {
+                memmove(value + n, value + n + m, length - n - m);
+            });
+            break;
+        case 'i':
+            resizing([n, x](char* value, uint32_t length, uint32_t) {
+                memmove(value + n + 1, value + n, length - n);
+                value[n] = x;
+            });
+            break;
+        case 'z':
+            resizing([n](char* value, uint32_t length, uint32_t) {
+                const char c = value[0];
+                memmove(value + n, value, length);
+                memset(value, c, n);
+            });
+            break;
+        case 'Z':
+            resizing([n](char* value, uint32_t length, uint32_t) {
+                memset(value + length, value[length - 1], n);
+            });
+            break;
+        case 'y':
+            resizing([n](char* value, uint32_t length, uint32_t) {
+                memmove(value + n, value, length);
+                memcpy(value, value + n, n);
+            });
+            break;
+        case 'Y':
+            resizing([n](char* value, uint32_t length, uint32_t) {
+                memcpy(value + length, value + length - n, n);
+            });
+            break;
+        case ']':
+        case '\'':
+            // Only the length changes.
+            resizing([](char*, uint32_t, uint32_t) { });
+            break;
+        case 'o':
+            each(values, stride, lengths, count, [n, x](char* value, uint32_t& length) {
+                if (n < length)
+                    value[n] = x;
+            });
+            break;
+        case 's':
+            each(values, stride, lengths, count, [x, y](char* value, uint32_t& length) {
+                replace_all(value, length, x, y);
+            });
+            break;
+        case '@':
+            each(values, stride, lengths, count, [x](char* value, uint32_t& length) {
+                length = remove_all(value, length, x);
+            });
+            break;
+        case '{':
+            each(values, stride, lengths, count, [](char* value, uint32_t& length) {
+                if (length != 0)
+                    std::rotate(value, value + 1, value + length);
+            });
+            break;
+        case '}':
+            each(values, stride, lengths, count, [](char* value, uint32_t& length) {
+                if (length != 0)
+                    std::rotate(value, value + length - 1, value + length);
+            });
+            break;
+        case 'k':
+            each(values, stride, lengths, count, [](char* value, uint32_t& length) {
+                if (length >= 2)
+                    std::swap(value[0], value[1]);
+            });
+            break;
+        case 'K':
+            each(values, stride, lengths, count, [](char* value, uint32_t& length) {
+                if (length >= 2)
+                    std::swap(value[length - 2], value[length - 1]);
+            });
+            break;
+        case '*':
+            each(values, stride, lengths, count, [n, m](char* value, uint32_t& length) {
+                if (n < length && m < length)
+                    std::swap(value[n], value[m]);
+            });
+            break;
+        }
+    }
+}
+
+size_t mangling_rules::apply(size_t rule, std::string_view word, char* output) const
+{
+    memcpy(output, word.data(), word.size());
+
+    uint32_t length = uint32_t(word.size());
+    apply(rule, output, 0, &length, 1);
+    return length;
+}
+
+std::pair<size_t, size_t> mangling_rules::lengths(size_t shortest, size_t longest) const
+{
+    size_t low = max_length;
+    size_t high = longest;
+
+    // Every length a word can have after each function, starting from every length in between
+    // shortest and longest; only @ makes more than one of a single length.
+    std::vector<char> possible;
+    std::vector<char> next;
+    for (auto [first, size] : _rules) {
+        possible.assign(max_length + 1, 0);
+        std::fill(possible.begin() + shortest, possible.begin() + longest + 1, 1);
+
+        uint32_t min = uint32_t(shortest);
+        uint32_t max = uint32_t(longest);
+        for (uint32_t f = first; f < first + size; ++f) {
+            function_t const& function = _functions[f];
+
+            next.assign(max_length + 1, 0);
+            uint32_t next_min = max_length;
+            uint32_t next_max = 0;
+            for (uint32_t length = min; length <= max; ++length) {
+                if (!possible[length])
+                    continue;
+
+                if (function.name == '@') {
+                    std::fill(next.begin(), next.begin() + length + 1, 1);
+                    next_min = 0;
+                    next_max = std::max(next_max, length);
+                    continue;
+                }
+
+                const uint32_t resized_length = resized(function, length);
+                next[resized_length] = 1;
+                next_min = std::min(next_min, resized_length);
+                next_max = std::max(next_max, resized_length);
+            }
+
+            possible.swap(next);
+            min = next_min;
+            max = next_max;
+            high = std::max<size_t>(high, max);
+        }
+
+        low = std::min<size_t>(low, min);
+    }
+
+    return { low, high };
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Mangling rules for {file.txt|rules.txt} pattern nodes: every rule of the file is applied to every
+// word of the wordlist, so that variations of known names (digits appended, plurals, other
+// extensions, underscores as spaces) are enumerated as they are hashed, never written out.
+//
+// Rules are spelled as in hashcat, one per line; empty lines and lines starting with # are skipped.
+// A rule is a sequence of functions, each one character followed by its arguments: positions N and
+// M are 0-9, then A-Z for 10 to 35, and characters X and Y are normalized like literals. Spaces
+// between functions are ignored.
+//   :        nothing                           r        reverse
+//   $X  ^X   append, prepend X                 d  f     append a copy, a reversed copy
+//   [  ]     delete the first, last character  pN       append N copies
+//   DN       delete at N                       q        double every character
+//   'N       truncate to N characters          {  }     rotate left, right
+//   xNM      keep M characters from N          k  K     swap the first two, last two
+//   ONM      delete M characters from N        *NM      swap the characters at N and M
+//   iNX      insert X at N                     zN  ZN   repeat the first, last character N times
+//   oNX      overwrite the character at N      yN  YN   repeat the first, last N characters
+//   sXY      replace every X with Y            @X       delete every X
+// Case functions (l u c C t TN E eX) are accepted and do nothing, since values are hashed uppercase.
+// As in hashcat, a function that refers to characters past the end of the word, or that would make
+// it longer than uploaded_string::max_length characters, leaves the word as is. An extension swap
+// is spelled ]]]]$.$T$G$A, a plural $S.
+//
+// Rejection and memory functions are not supported: every rule makes exactly one value of every
+// word, so that the values of a node can still be counted, and any of them found from its index.
+// Rules that do the same once case functions are left out are only kept once.
+class mangling_rules {
+public:
+    // Returns the rules of the file at path, parsing it unless it is still loaded for another
+    // pattern; every copy of a pattern shares the same rules.
+    static std::shared_ptr<const mangling_rules> open(std::string const& path);
+
+    mangling_rules(mangling_rules const&) = delete;
+    mangling_rules& operator = (mangling_rules const&) = delete;
+
+    std::string const& path() const { return _path; }
+
+    size_t size() const { return _rules.size(); }
+
+    // Applies rule to the count words of values, each one stride bytes after the previous one and
+    // lengths[i] characters long, in place; each must have room for uploaded_string::max_length
+    // characters. Functions are applied one at a time to every word, so that each is only decoded
+    // once per batch, and its loop over the words is a tight one.
+    void apply(size_t rule, char* values, size_t stride, uint32_t* lengths, size_t count) const;
+
+    // Same as above, for a single word, written to output; returns its length.
+    size_t apply(size_t rule, std::string_view word, char* output) const;
+
+    // Lengths of the shortest and longest values the rules make of words of lengths between
+    // shortest and longest, including those of words being mangled, so that a buffer of the
+    // latter size holds any of them along the way.
+    std::pair<size_t, size_t> lengths(size_t shortest, size_t longest) const;
+
+private:
+    explicit mangling_rules(std::string path);
+
+    // One function of a rule, and its arguments.
+    struct function_t {
+        char name;
+        uint8_t n;
+        uint8_t m;
+        char x;
+        char y;
+    };
+
+    // Length of a word of length characters once function is applied; only depends on the
+    // characters of the word for @, which this does not handle.
+    static uint32_t resized(function_t const& function, uint32_t length);
+
+    std::string _path;
+
+    // Functions of every rule, in rule order, and the (offset, count) of each rule's.
+    std::vector<function_t> _functions;
+    std::vector<std::pair<uint32_t, uint32_t>> _rules;
+};
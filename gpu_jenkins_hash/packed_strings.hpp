@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+// Variable-length alternative to arrays of uploaded_string, over memory owned by someone else
+// (usually a mapped staging buffer). Laid out in 32-bit words:
+//   header: string count, word offset of the arena (from the end of the header), two reserved words
+//   table: one record per string: word offset in the arena, length in bytes, hash
+//   arena: the strings back to back, each starting on a word boundary and zero-padded up to the next
+// The table always has room for capacity() records, so the arena never moves. See jenkins.comp,
+// built with PACKED_STRINGS, for the device side.
+class packed_strings {
+public:
+    constexpr static const size_t header_words = 4;
+    constexpr static const size_t record_words = 3;
+
+    // Arena size the engines plan for, per string; candidates are usually much shorter.
+    constexpr static const size_t default_bytes_per_string = 64;
+
+    // Number of words needed to store up to capacity strings, arena_bytes bytes of them in total.
+    static size_t required_words(size_t capacity, size_t arena_bytes) {
+        return header_words + capacity * record_words + (arena_bytes + 3) / 4;
+    }
+
+    packed_strings() = default;
+
+    packed_strings(uint32_t* storage, size_t capacity, size_t arena_bytes)
+        : _storage(storage), _capacity(capacity), _arena_words((arena_bytes + 3) / 4)
+    {
+        clear();
+    }
+
+    void clear() {
+        _storage[0] = 0;
+        _storage[1] = uint32_t(_capacity * record_words);
+        _storage[2] = 0;
+        _storage[3] = 0;
+        _used_words = 0;
+    }
+
+    size_t size() const { return _storage[0]; }
+    size_t capacity() const { return _capacity; }
+
+    // Returns room for a string of up to max_length characters at the end of the arena, or nullptr
+    // if either the arena or the table is full. Nothing is added until commit() is called.
+    char* reserve(size_t max_length) {
+        if (size() == _capacity || _used_words + (max_length + 3) / 4 > _arena_words)
+            return nullptr;
+
+        return reinterpret_cast<char*>(arena() + _used_words);
+    }
+
+    // Adds the length characters written at the location reserve() returned.
+    void commit(size_t length) {
+        uint32_t* words = arena() + _used_words;
+
+        // Zero the padding of the last word.
+        size_t word_count = (length + 3) / 4;
+        if (length % 4 != 0)
+            memset(reinterpret_cast<char*>(words) + length, 0, 4 - length % 4);
+
+        uint32_t* entry = record(size());
+        entry[0] = uint32_t(_used_words);
+        entry[1] = uint32_t(length);
+        entry[2] = 0;
+
+        _used_words += word_count;
+        ++_storage[0];
+    }
+
+    bool push_back(std::string_view value) {
+        char* storage = reserve(value.size());
+        if (storage == nullptr)
+            return false;
+
+        memcpy(storage, value.data(), value.size());
+        commit(value.size());
+        return true;
+    }
+
+    std::string_view value(size_t index) const {
+        uint32_t const* entry = record(index);
+        return std::string_view(reinterpret_cast<const char*>(arena() + entry[0]), entry[1]);
+    }
+
+    // Words of the string at index, zero-padded up to the last one.
+    uint32_t const* words(size_t index) const {
+        return arena() + record(index)[0];
+    }
+
+    uint32_t hash(size_t index) const { return record(index)[2]; }
+    void set_hash(size_t index, uint32_t hash) { record(index)[2] = hash; }
+
+    // Number of words from the start of the storage to the end of the last string.
+    size_t used_words() const {
+        return header_words + _capacity * record_words + _used_words;
+    }
+
+    // Number of words of the header and table, which is all there is to read back after hashing.
+    size_t table_words() const {
+        return header_words + _capacity * record_words;
+    }
+
+private:
+    uint32_t* _storage = nullptr;
+    size_t _capacity = 0;
+    size_t _arena_words = 0;
+
+    // Words of the arena in use.
+    size_t _used_words = 0;
+
+    uint32_t* record(size_t index) { return _storage + header_words + index * record_words; }
+    uint32_t const* record(size_t index) const { return _storage + header_words + index * record_words; }
+
+    uint32_t* arena() { return _storage + header_words + _capacity * record_words; }
+    uint32_t const* arena() const { return _storage + header_words + _capacity * record_words; }
+};
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "parallel_input.hpp"
+
+// Smallest range of values worth handing to another thread.
+constexpr const size_t minimumJobSize = 1024;
+
+parallel_input::parallel_input(input_file& input, size_t threadCount) : _input(input)
+{
+    // The thread calling fill() is one of them.
+    for (size_t i = 1; i < std::max<size_t>(threadCount, 1); ++i)
+        _workers.emplace_back(&parallel_input::workerLoop, this);
+}
+
+parallel_input::~parallel_input()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _exiting = true;
+    }
+    _jobAvailable.notify_all();
+
+    for (std::thread& worker : _workers)
+        if (worker.joinable())
+            worker.join();
+}
+
+bool parallel_input::loadNext()
+{
+    while (_next == _patternEnd) {
+        pattern_range range;
+        if (!_input.nextPattern(range))
+            return false;
+
+        _current.load(range.pattern);
+        _patternEnd = std::min(range.end, _current.count());
+        _next = std::min(range.first, _patternEnd);
+        _produced = 0;
+
+        _pattern = std::make_shared<const Pattern>(Pattern{ range.pattern, _pattern ? _pattern->id + 1 : 1 });
+
+        std::cout << ">> Loaded pattern '" << range.pattern << "' (" << _current.count() << " possible values).\n";
+    }
+    return true;
+}
+
+size_t parallel_input::fill(uploaded_string* output, size_t capacity)
+{
+    const size_t threadCount = getThreadCount();
+
+    size_t written = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // A frame may span several patterns; each one is split on its own.
+        while (written < capacity && loadNext()) {
+            size_t count = size_t(std::min<uint64_t>(capacity - written, _patternEnd - _next));
+            size_t jobSize = std::max(minimumJobSize, (count + threadCount - 1) / threadCount);
+
+            for (size_t offset = 0; offset < count; offset += jobSize) {
+                _jobs.push_back(Job{ _pattern, _next + offset, std::min(jobSize, count - offset), output + written + offset });
+                ++_pending;
+            }
+
+            _next += count;
+            _produced += count;
+            written += count;
+        }
+    }
+    _jobAvailable.notify_all();
+
+    while (runJob(_self))
+        ;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _jobsDone.wait(lock, [this]() { return _pending == 0; });
+    }
+
+    // Empty strings are skipped by the shader.
+    if (written < capacity)
+        memset(output + written, 0, sizeof(uploaded_string) * (capacity - written));
+
+    return written;
+}
+
+bool parallel_input::runJob(Worker& worker)
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_jobs.empty())
+            return false;
+
+        job = std::move(_jobs.front());
+        _jobs.pop_front();
+    }
+
+    write(worker, job);
+
+    bool done = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        done = --_pending == 0;
+    }
+
+    if (done)
+        _jobsDone.notify_all();
+
+    return true;
+}
+
+void parallel_input::write(Worker& worker, Job const& job)
+{
+    if (worker.id != job.pattern->id) {
+        worker.pattern.load(job.pattern->line);
+        worker.id = job.pattern->id;
+    }
+
+    // Jobs of a pattern are taken in order, so a worker usually only has to move ahead.
+    const uint64_t next = worker.pattern.next_index();
+    if (worker.pattern.has_next() && next <= job.begin)
+        worker.pattern.advance(job.begin - next);
+    else
+        worker.pattern.seek(job.begin);
+    worker.pattern.write(job.output, job.count);
+}
+
+void parallel_input::workerLoop()
+{
+    Worker worker;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobAvailable.wait(lock, [this]() { return _exiting || !_jobs.empty(); });
+
+            if (_exiting)
+                return;
+        }
+
+        runJob(worker);
+    }
+}
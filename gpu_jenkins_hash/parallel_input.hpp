@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "input_file.hpp"
+#include "pattern.hpp"
+#include "uploaded_string.hpp"
+
+// Multi-threaded alternative to calling input_file::next() for every string of a frame.
+// The values a frame takes from each pattern are split into disjoint index ranges, and every
+// thread writes its ranges straight into the frame (usually a mapped staging buffer), starting
+// from pattern_t::seek(). Each thread parses its own copy of the pattern, so no enumeration state
+// is shared. Values come out in exactly the same order as with input_file::next().
+class parallel_input {
+public:
+    parallel_input(input_file& input, size_t threadCount);
+    ~parallel_input();
+
+    parallel_input(parallel_input const&) = delete;
+    parallel_input& operator = (parallel_input const&) = delete;
+
+    // Same contract as a data provider: writes up to capacity strings to output, zeroes the rest,
+    // and returns how many were written; zero once the file is exhausted.
+    size_t fill(uploaded_string* output, size_t capacity);
+
+    // Same as input_file::prefix() and input_file::producedFromCurrent(), as of the last fill().
+    std::string_view prefix() const { return _current.prefix(); }
+    size_t producedFromCurrent() const { return _produced; }
+
+    // Same as input_file::position(), as of the last fill().
+    input_position position() const { return input_position{ _input.patternsRead(), _next }; }
+
+    size_t getThreadCount() const { return _workers.size() + 1; }
+
+private:
+    // Patterns are numbered as they are loaded, so that workers know when to parse a new one.
+    struct Pattern {
+        std::string line;
+        uint64_t id;
+    };
+
+    // Values [begin, begin + count) of a pattern, written to output.
+    struct Job {
+        std::shared_ptr<const Pattern> pattern;
+        uint64_t begin;
+        size_t count;
+        uploaded_string* output;
+    };
+
+    input_file& _input;
+
+    // Pattern being enumerated, index of its next value, and index its enumeration stops at.
+    std::shared_ptr<const Pattern> _pattern;
+    pattern_t _current;
+    uint64_t _next = 0;
+    uint64_t _patternEnd = 0;
+    size_t _produced = 0;
+
+    std::vector<std::thread> _workers;
+    std::deque<Job> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _jobAvailable;
+    std::condition_variable _jobsDone;
+    size_t _pending = 0;
+    bool _exiting = false;
+
+    // Copy of the pattern a thread last wrote values of; ids start at 1.
+    struct Worker {
+        pattern_t pattern;
+        uint64_t id = 0;
+    };
+
+    // The thread calling fill() takes its share of the jobs as well.
+    Worker _self;
+
+    bool loadNext();
+
+    void workerLoop();
+
+    bool runJob(Worker& worker);
+    static void write(Worker& worker, Job const& job);
+};
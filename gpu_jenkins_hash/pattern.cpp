@@ -1,7 +1,11 @@
 #include "pattern.hpp"
 #include "string_view_range.hpp"
+#include "checked_math.hpp"
 
+#include <cctype>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 auto find_delimiter(std::string_view const& view, char delimiter, size_t ofs = std::string::npos) -> size_t {
 
@@ -23,44 +27,53 @@ auto find_delimiter(std::string_view const& view, char delimiter, size_t ofs = s
     return nextDelimiter;
 };
 
+namespace {
+    // Values are hashed as uppercase, backslash-separated paths.
+    void normalize(std::string& s) {
+        // Remove escape sequences
+        s.erase(std::remove(s.begin(), s.end(), '\\'), s.end());
+
+        for (char& c : s)
+        {
+            if (c == '/')
+                c = '\\';
+            else
+                c = std::toupper(c);
+        }
+    }
+}
+
 // non-varying characters /////////////////////////////////
 
 std::string_view raw_range_t::parse(std::string_view view)
 {
-    size_t delim = find_delimiter(view, '(');
-    if (delim == std::string::npos)
-        delim = find_delimiter(view, '[');
+    // Raw characters stop at whichever node comes first.
+    size_t delim = std::min({ find_delimiter(view, '('), find_delimiter(view, '['), find_delimiter(view, '{') });
 
     if (delim == 0)
         return view;
 
     std::string s(view.substr(std::min(size_t(0), delim), std::min(view.size(), delim)));
-    // Remove escape sequences
-    s.erase(std::remove(s.begin(), s.end(), '\\'), s.end());
+    size_t consumed = s.size();
 
-    for (char& c : s)
-    {
-        if (c == '/')
-            c = '\\';
-        else
-            c = std::toupper(c);
-    }
+    normalize(s);
 
-    val.push_back(s);
-    return view.substr(s.size());
+    val = std::move(s);
+    return view.substr(consumed);
 }
 
-size_t raw_range_t::apply(char* storage, size_t offset) {
-    memcpy(storage + offset, val[0].data(), val[0].size());
-    return offset + val[0].size();
+void raw_range_t::compile(pattern_program& program) const {
+    program.add_literal(val);
 }
 
 // parse size decoration {x, y} or {x} /////////////////////
 
 std::string_view size_specified_range_t::parse(std::string_view view)
 {
+    // The decoration, if any, immediately follows the node. A brace that is not followed
+    // by a digit opens a wordlist instead: [a-z]{words.txt}
     size_t delim = find_delimiter(view, '{');
-    if (delim == std::string::npos)
+    if (delim != 0 || view.size() < 2 || !std::isdigit(static_cast<unsigned char>(view[1])))
     {
         max_count = min_count = 1;
         return view;
@@ -89,7 +102,7 @@ std::string_view size_specified_range_t::parse(std::string_view view)
 
 std::string_view array_range_t::parse(std::string_view view) {
     size_t delim = find_delimiter(view, '(');
-    if (delim == std::string::npos)
+    if (delim != 0)
         return view;
 
     size_t end_delim = find_delimiter(view, ')', delim);
@@ -101,7 +114,7 @@ std::string_view array_range_t::parse(std::string_view view) {
     for (;;) {
         splitterOfs = find_delimiter(work_view, '|', splitterOfs + 1);
         if (splitterOfs != std::string::npos) {
-            vals.emplace_back(work_view.substr(startOffset, splitterOfs));
+            vals.emplace_back(work_view.substr(startOffset, splitterOfs - startOffset));
             startOffset = splitterOfs + 1;
         }
         else {
@@ -110,26 +123,14 @@ std::string_view array_range_t::parse(std::string_view view) {
         }
     }
 
-    reset();
+    for (std::string& value : vals)
+        normalize(value);
 
     return size_specified_range_t::parse(view.substr(end_delim + 1));
 }
 
-void array_range_t::reset() {
-    itr = vals.begin();
-}
-
-bool array_range_t::has_next() {
-    return itr != vals.end();
-}
-
-size_t array_range_t::apply(char* storage, size_t offset) {
-    memcpy(storage + offset, itr->data(), itr->size());
-    return offset + itr->size();
-}
-
-void array_range_t::move_next() {
-    ++itr;
+void array_range_t::compile(pattern_program& program) const {
+    program.add_array(vals);
 }
 
 // parse a range of values [a-z|0-1|alpha|alnum|hex|path] ////////////////////
@@ -137,7 +138,7 @@ void array_range_t::move_next() {
 std::string_view varying_range_t::parse(std::string_view view) {
     size_t delim = find_delimiter(view, '[');
 
-    if (delim == std::string::npos)
+    if (delim != 0)
         return view;
 
     size_t end_delim = find_delimiter(view, ']', delim);
@@ -193,60 +194,220 @@ std::string_view varying_range_t::parse(std::string_view view) {
         }
     }
 
-    std::string_view retval = size_specified_range_t::parse(view.substr(end_delim + 1));
+    return size_specified_range_t::parse(view.substr(end_delim + 1));
+}
+
+void varying_range_t::compile(pattern_program& program) const {
+    program.add_varying(std::string(universe.begin(), universe.end()), min_count, max_count);
+}
+
+// parse a wordlist {file.txt} or {file.txt|rules.txt} ////////////////////////////
 
+std::string_view dictionary_range_t::parse(std::string_view view) {
+    size_t delim = find_delimiter(view, '{');
+    if (delim != 0)
+        return view;
+
+    size_t end_delim = find_delimiter(view, '}', delim);
+    if (end_delim == std::string::npos)
+        throw std::runtime_error("Unterminated wordlist");
+
+    // Paths are taken as is, relative to the working directory.
+    std::string_view work_view = view.substr(delim + 1, end_delim - delim - 1);
 
-    itr = rolling_iterator<decltype(universe)::const_iterator>(universe.begin(), universe.end());
-    itr.expand(min_count);
+    size_t separator = work_view.find('|');
+    path = std::string(work_view.substr(0, separator));
+    if (separator != std::string::npos)
+        rules = std::string(work_view.substr(separator + 1));
 
-    return retval;
+    return view.substr(end_delim + 1);
 }
 
+void dictionary_range_t::compile(pattern_program& program) const {
+    if (rules.empty())
+        program.add_dictionary(wordlist::open(path));
+    else
+        program.add_mangled(wordlist::open(path), mangling_rules::open(rules));
+}
 
-uint64_t varying_range_t::count() {
-    if (min_count == max_count) {
-		auto s = std::pow(universe.size(), min_count);
-        return uint64_t(s);
-    }
 
-	uint64_t u = universe.size();
+// compiled patterns /////////////////////////////////////
+
+void pattern_program::add_literal(std::string_view value) {
+    pattern_step step{};
+    step.kind = pattern_step::literal;
+    step.data = uint32_t(characters.size());
+    step.size = uint32_t(value.size());
+    step.shortest = value.size();
+    step.longest = value.size();
+
+    characters += value;
+    steps.push_back(step);
+}
 
-    if (min_count == 1) {
-		auto s = ((std::pow(u, max_count) - 1) * u) / (u - 1);
-        return uint64_t(s);
+void pattern_program::add_array(std::vector<std::string> const& alternatives) {
+    pattern_step step{};
+    step.kind = pattern_step::array;
+    step.data = uint32_t(values.size());
+    step.size = uint32_t(alternatives.size());
+    step.count = alternatives.size();
+    step.shortest = alternatives.empty() ? 0 : std::numeric_limits<size_t>::max();
+
+    for (std::string const& value : alternatives) {
+        values.emplace_back(uint32_t(characters.size()), uint32_t(value.size()));
+        characters += value;
+
+        step.shortest = std::min(step.shortest, value.size());
+        step.longest = std::max(step.longest, value.size());
     }
 
-	auto s = (std::pow(u, max_count - 1) - std::pow(u, min_count)) / (u - 1);
-	return uint64_t(s);
+    steps.push_back(step);
+}
+
+void pattern_program::add_dictionary(std::shared_ptr<const wordlist> words) {
+    if (words->size() == 0)
+        throw std::runtime_error("Wordlist '" + words->path() + "' holds no words");
+
+    pattern_step step{};
+    step.kind = pattern_step::dictionary;
+    step.data = uint32_t(wordlists.size());
+    step.size = uint32_t(words->size());
+    step.count = words->size();
+    step.shortest = words->shortest();
+    step.longest = words->longest();
+
+    wordlists.push_back(std::move(words));
+    steps.push_back(step);
 }
 
-size_t varying_range_t::apply(char* storage, size_t offset) {
-    size_t size = itr.size();
+void pattern_program::add_mangled(std::shared_ptr<const wordlist> words, std::shared_ptr<const mangling_rules> mangling) {
+    if (words->size() == 0)
+        throw std::runtime_error("Wordlist '" + words->path() + "' holds no words");
+
+    pattern_step step{};
+    step.kind = pattern_step::mangled;
+    step.data = uint32_t(wordlists.size());
+    step.size = uint32_t(words->size());
+    step.rules = uint32_t(rules.size());
+    step.count = uint64_t(words->size()) * mangling->size();
+
+    // The longest length is that of the longest word while it is being mangled, which values are
+    // rendered in place of.
+    auto [shortest, longest] = mangling->lengths(words->shortest(), words->longest());
+    step.shortest = shortest;
+    step.longest = longest;
+
+    wordlists.push_back(std::move(words));
+    rules.push_back(std::move(mangling));
+    steps.push_back(step);
+}
+
+void pattern_program::add_varying(std::string_view alphabet, size_t min_length, size_t max_length) {
+    pattern_step step{};
+    step.kind = pattern_step::varying;
+    step.data = uint32_t(characters.size());
+    step.size = uint32_t(alphabet.size());
+    step.min_length = uint32_t(min_length);
+    step.max_length = uint32_t(std::max(min_length, max_length));
+    step.shortest = step.min_length;
+    step.longest = step.max_length;
+
+    // Patterns that have too many values are only rejected by count(), so that exact_count() still
+    // works for them.
+    uint128 count = step_count(step);
+    step.count = count.fits_64() ? count.low : std::numeric_limits<uint64_t>::max();
+
+    characters += alphabet;
+    steps.push_back(step);
+}
+
+uint128 pattern_program::step_count(pattern_step const& step) {
+    if (step.kind != pattern_step::varying)
+        return step.count;
+
+    uint128 power = 1;
+    for (size_t length = 0; length < step.min_length; ++length)
+        if (!uint128::multiply(power, step.size, power))
+            throw std::runtime_error("Pattern has more than 2^128 values");
+
+    // Values of every length, from min_length to max_length.
+    uint128 count = 0;
+    for (size_t length = step.min_length; ; ++length) {
+        if (!uint128::add(count, power, count))
+            throw std::runtime_error("Pattern has more than 2^128 values");
+
+        if (length >= step.max_length)
+            break;
+
+        if (!uint128::multiply(power, step.size, power))
+            throw std::runtime_error("Pattern has more than 2^128 values");
+    }
+
+    return count;
+}
 
-    memcpy(storage + offset, itr.current(), size);
+uint128 pattern_program::exact_count() const {
+    uint128 count = 1;
+    for (pattern_step const& step : steps)
+        if (!uint128::multiply(count, step_count(step), count))
+            throw std::runtime_error("Pattern has more than 2^128 values");
 
-    return offset + size;
+    return count;
 }
 
-void varying_range_t::reset() {
-    itr.shrink_to(min_count);
+uint64_t pattern_program::count() const {
+    uint128 count = exact_count();
+    if (!count.fits_64())
+        throw std::runtime_error("Pattern has too many values");
+
+    return count.low;
 }
 
-bool varying_range_t::has_next() {
-    // if done on the gen we have work if not last gen
-    if (itr.all_done())
-        return itr.size() < max_count;
+size_t pattern_program::longest() const {
+    size_t length = 0;
+    for (pattern_step const& step : steps)
+        length += step.longest;
 
-    // otherwise more work if gen not dont
-    return !itr.all_done();
+    return length;
 }
 
-void varying_range_t::move_next() {
-    itr.move_next();
-    // if done on this level but there's more, expand
-    if (itr.all_done())
-        if (itr.size() < max_count)
-            itr.expand();
+namespace {
+    // Splits the index of a value of a varying step into its length and its index among the
+    // values of that length; shorter values come first.
+    std::pair<uint32_t, uint64_t> locate(pattern_step const& step, uint64_t index) {
+        uint64_t power = 1;
+        for (uint32_t length = 0; length < step.min_length; ++length)
+            power *= step.size;
+
+        uint32_t length = step.min_length;
+        while (index >= power) {
+            index -= power;
+            power *= step.size;
+            ++length;
+        }
+
+        return { length, index };
+    }
+
+    // Inverse of locate(): index among the values of a varying step of the value of length
+    // characters the digits of odometer stand for.
+    uint64_t position(pattern_step const& step, uint32_t length, rolling_iterator const& odometer) {
+        uint64_t power = 1;
+        for (uint32_t i = 0; i < step.min_length; ++i)
+            power *= step.size;
+
+        uint64_t index = 0;
+        for (uint32_t shorter = step.min_length; shorter < length; ++shorter) {
+            index += power;
+            power *= step.size;
+        }
+
+        uint64_t value = 0;
+        for (uint32_t i = 0; i < length; ++i)
+            value = value * step.size + odometer[i];
+
+        return index + value;
+    }
 }
 
 template <typename T, typename... Ts>
@@ -290,97 +451,424 @@ pattern_t::pattern_t(std::string_view regex)
     load(regex);
 }
 
-void pattern_t::load(std::string_view regex)
+pattern_program pattern_t::compile(std::string_view regex)
 {
-    reset();
+    using full_tester_t = chain_tester<raw_range_t, array_range_t, varying_range_t, dictionary_range_t>;
 
-    using full_tester_t = chain_tester<raw_range_t, array_range_t, varying_range_t>;
+    pattern_program program;
 
     node_t* node = nullptr;
     while (regex.size() > 0 && full_tester_t::test(regex, node))
     {
-        if (head == nullptr)
-            head = node;
+        std::unique_ptr<node_t> owner(node);
+        owner->compile(program);
+    }
 
-        if (tail != nullptr)
-        {
-            node->prev = tail;
-            tail->next = node;
+    if (regex.size() > 0)
+        throw std::runtime_error("Failed to parse pattern");
+
+    return program;
+}
+
+void pattern_t::load(std::string_view regex)
+{
+    program = compile(regex);
+
+    if (program.longest() > uploaded_string::max_length)
+        throw std::runtime_error("Pattern values may be longer than " + std::to_string(uploaded_string::max_length) + " characters");
+
+    total = program.count();
+    end = total;
+
+    // Each step is one digit of the index of a value, the last step being the least significant.
+    const size_t step_count = program.steps.size();
+    strides.assign(step_count, 1);
+    for (size_t s = step_count; s-- > 1; )
+        strides[s - 1] = checked_multiply(strides[s], program.steps[s].count);
+
+    digits.clear();
+    odometers.clear();
+    states.assign(step_count, step_state{});
+    for (size_t s = 0; s < step_count; ++s) {
+        pattern_step const& step = program.steps[s];
+
+        if (step.listed()) {
+            states[s].digit = uint32_t(digits.size());
+            digits.push_back(0);
+        }
+        else if (step.kind == pattern_step::mangled) {
+            states[s].digit = uint32_t(digits.size());
+            digits.push_back(0);
+            digits.push_back(0);
+        }
+        else if (step.kind == pattern_step::varying) {
+            states[s].digit = uint32_t(odometers.size());
+            odometers.emplace_back(step.size, step.min_length, step.max_length);
         }
+    }
+
+    current.assign(program.longest(), 0);
 
-        // lock all nodes...
-        node->lock();
+    generator = find_generator(program);
 
-        tail = node;
+    // Values come in runs sharing everything before the last step that is not a literal.
+    tail = step_count;
+    for (size_t s = step_count; s-- > 0; ) {
+        if (program.steps[s].kind != pattern_step::literal) {
+            tail = s;
+            break;
+        }
     }
 
-    // ... except the last one
-    tail->unlock();
+    seek(0);
+}
 
-    if (regex.size() > 0)
-        throw std::runtime_error("Failed to parse pattern");
+std::string_view pattern_t::prefix() const
+{
+    if (program.steps.empty() || program.steps[0].kind != pattern_step::literal)
+        return std::string_view();
+
+    return program.string(program.steps[0].data, program.steps[0].size);
+}
+
+std::string_view pattern_t::head() const
+{
+    if (tail >= program.steps.size())
+        return std::string_view(current.data(), current_length);
+
+    return std::string_view(current.data(), states[tail].start);
+}
+
+uint64_t pattern_t::run_remaining() const
+{
+    if (!has_next())
+        return 0;
 
-    idx = count();
+    const uint64_t run = tail == 0 ? total : tail < strides.size() ? strides[tail - 1] : 1;
+    return std::min(idx, run - next_index() % run);
 }
 
-uint64_t pattern_t::count() const
+void pattern_t::seek(uint64_t index)
 {
-	uint64_t count = 1;
-    node_t* h = head;
-    while (h != nullptr) {
-        count *= h->count();
-        h = h->next;
+    if (index >= end) {
+        idx = 0;
+        return;
     }
 
-    return count;
+    for (size_t s = 0; s < program.steps.size(); ++s) {
+        pattern_step const& step = program.steps[s];
+        step_state& state = states[s];
+
+        uint64_t digit = (index / strides[s]) % step.count;
+
+        if (step.listed())
+            digits[state.digit] = uint32_t(digit);
+        else if (step.kind == pattern_step::mangled) {
+            digits[state.digit] = uint32_t(digit % step.size);
+            digits[state.digit + 1] = uint32_t(digit / step.size);
+        }
+        else if (step.kind == pattern_step::varying) {
+            auto [length, value] = locate(step, digit);
+
+            state.length = length;
+            odometers[state.digit].seek(length, value);
+        }
+
+        // Makes render() write literals as well.
+        state.start = std::numeric_limits<uint32_t>::max();
+    }
+
+    render(0, 0);
+
+    idx = end - index;
+    unchanged = 0;
 }
 
-bool pattern_t::has_next() const
+void pattern_t::advance(uint64_t n)
 {
-    return idx > 0;
+    if (n == 0)
+        return;
+
+    if (n >= idx) {
+        idx = 0;
+        return;
+    }
+
+    // Adds n to the index in the mixed radix of the steps, the last one being the least
+    // significant digit: each step adds its share of n and carries to the one before it, and
+    // carrying stops at the first step that does not wrap around.
+    size_t first_changed = program.steps.size();
+    uint64_t carry = n;
+
+    // Adds add to digit, both less than count, modulo count; wrapping around carries one more.
+    // Counts may be close to 2^64, so what is left before wrapping is compared instead of the sum.
+    auto add_digit = [&carry](uint64_t digit, uint64_t add, uint64_t count) -> uint64_t {
+        if (add < count - digit)
+            return digit + add;
+
+        ++carry;
+        return add - (count - digit);
+    };
+
+    for (size_t s = program.steps.size(); s-- > 0 && carry != 0; ) {
+        pattern_step const& step = program.steps[s];
+        step_state& state = states[s];
+
+        const uint64_t add = carry % step.count;
+        carry /= step.count;
+        if (add == 0)
+            continue;
+
+        first_changed = s;
+
+        if (step.listed())
+            digits[state.digit] = uint32_t(add_digit(digits[state.digit], add, step.count));
+        else if (step.kind == pattern_step::mangled) {
+            const uint64_t digit = add_digit(uint64_t(digits[state.digit + 1]) * step.size + digits[state.digit], add, step.count);
+
+            digits[state.digit] = uint32_t(digit % step.size);
+            digits[state.digit + 1] = uint32_t(digit / step.size);
+        }
+        else if (step.kind == pattern_step::varying) {
+            auto [length, value] = locate(step, add_digit(position(step, state.length, odometers[state.digit]), add, step.count));
+
+            state.length = length;
+            odometers[state.digit].seek(length, value);
+        }
+    }
+
+    render(first_changed, 0);
+
+    idx -= n;
+    unchanged = 0;
 }
 
-bool pattern_t::write(uploaded_string& output) {
-    if (!has_next())
-        return false;
+void pattern_t::limit(uint64_t last)
+{
+    const uint64_t index = next_index();
 
-    output.reset();
+    end = std::min(last, total);
+    seek(index);
+}
 
-    // TODO: Figure out a way to not have to iterate twice
+void pattern_t::render(size_t first_step, size_t first_char)
+{
+    uint32_t offset = first_step == 0 ? 0 : states[first_step - 1].start + states[first_step - 1].length;
 
-    node_t* h = head;
-    size_t offset = 0;
+    for (size_t s = first_step; s < program.steps.size(); ++s) {
+        pattern_step const& step = program.steps[s];
+        step_state& state = states[s];
 
-    h = tail;
-    while (h != nullptr) {
-        offset = std::max(offset, h->apply(reinterpret_cast<char*>(output.words), h->start_offset()));
+        const bool moved = state.start != offset;
+        state.start = offset;
 
-        if (!h->locked())
-            h->move_next();
+        switch (step.kind) {
+        case pattern_step::literal:
+            state.length = step.size;
+            if (moved)
+                memcpy(current.data() + offset, program.characters.data() + step.data, step.size);
+            break;
+        case pattern_step::array:
+        case pattern_step::dictionary: {
+            std::string_view value = program.value(step, digits[state.digit]);
 
-        node_t* prev = h->prev;
+            state.length = uint32_t(value.size());
+            memcpy(current.data() + offset, value.data(), value.size());
+            break;
+        }
+        case pattern_step::mangled: {
+            // Mangled in a buffer of its own, since words may grow past their final length on the
+            // way, over characters of the next steps that may not be written again.
+            const uint64_t index = uint64_t(digits[state.digit + 1]) * step.size + digits[state.digit];
+
+            char value[uploaded_string::max_length];
+            state.length = uint32_t(program.mangle(step, index, value));
+            memcpy(current.data() + offset, value, state.length);
+            break;
+        }
+        case pattern_step::varying: {
+            const char* alphabet = program.characters.data() + step.data;
+            const uint32_t* digit = odometers[state.digit].current();
 
-        if (!h->has_next()) {
+            for (size_t i = (s == first_step && !moved) ? first_char : 0; i < state.length; ++i)
+                current[offset + i] = alphabet[digit[i]];
+            break;
+        }
+        }
 
-            if (prev != nullptr) {
-                prev->unlock();
-                h->lock();
+        offset += state.length;
+    }
+
+    current_length = offset;
+}
 
-                if (prev->has_next())
-                    h->reset();
+size_t pattern_t::advance()
+{
+    // Like an odometer: the last digit advances, and every digit that wraps around resets and
+    // carries over to the one before it. Literals have a single value and always carry.
+    for (size_t s = program.steps.size(); s-- > 0; ) {
+        pattern_step const& step = program.steps[s];
+        step_state& state = states[s];
+
+        if (step.listed()) {
+            uint32_t& digit = digits[state.digit];
+            if (++digit < step.size) {
+                render(s, 0);
+                return state.start;
             }
+
+            digit = 0;
         }
-        else {
-            if (h->next != nullptr && !h->locked()) {
-                h->lock();
-                tail->unlock();
+        else if (step.kind == pattern_step::mangled) {
+            // Words first, then rules.
+            uint32_t& word = digits[state.digit];
+            uint32_t& rule = digits[state.digit + 1];
+            if (++word < step.size) {
+                render(s, 0);
+                return state.start;
             }
+
+            word = 0;
+            if (++rule < program.rules[step.rules]->size()) {
+                render(s, 0);
+                return state.start;
+            }
+
+            rule = 0;
         }
+        else if (step.kind == pattern_step::varying) {
+            auto& odometer = odometers[state.digit];
 
-        h = prev;
+            odometer.move_next();
+            if (!odometer.all_done()) {
+                render(s, odometer.changed);
+                return state.start + odometer.changed;
+            }
+
+            // Every character wrapped around; move on to longer values if there are any.
+            if (state.length < step.max_length) {
+                odometer.resize(++state.length);
+
+                render(s, 0);
+                return state.start;
+            }
+
+            state.length = step.min_length;
+            odometer.resize(state.length);
+        }
+    }
+
+    render(0, 0);
+    return 0;
+}
+
+bool pattern_t::write_at(uint64_t index, uploaded_string& output) const
+{
+    if (index >= total)
+        return false;
+
+    output.reset();
+
+    char* storage = reinterpret_cast<char*>(output.words);
+    size_t offset = 0;
+
+    for (size_t s = 0; s < program.steps.size(); ++s) {
+        pattern_step const& step = program.steps[s];
+        uint64_t digit = (index / strides[s]) % step.count;
+
+        switch (step.kind) {
+        case pattern_step::literal:
+            memcpy(storage + offset, program.characters.data() + step.data, step.size);
+            offset += step.size;
+            break;
+        case pattern_step::array:
+        case pattern_step::dictionary: {
+            std::string_view value = program.value(step, uint32_t(digit));
+
+            memcpy(storage + offset, value.data(), value.size());
+            offset += value.size();
+            break;
+        }
+        case pattern_step::mangled: {
+            // See render().
+            char value[uploaded_string::max_length];
+            size_t length = program.mangle(step, digit, value);
+
+            memcpy(storage + offset, value, length);
+            offset += length;
+            break;
+        }
+        case pattern_step::varying: {
+            auto [length, value] = locate(step, digit);
+
+            // The last character is the least significant digit.
+            for (uint32_t i = length; i-- > 0; ) {
+                storage[offset + i] = program.characters[step.data + value % step.size];
+                value /= step.size;
+            }
+
+            offset += length;
+            break;
+        }
+        }
     }
 
     output.char_count = int32_t(offset);
-    --idx;
+    return true;
+}
+
+bool pattern_t::write(uploaded_string& output) {
+    if (!has_next())
+        return false;
+
+    output.assign(std::string_view(current.data(), current_length));
+
+    // Nothing to move on to after the last value.
+    if (--idx > 0)
+        unchanged = advance();
+
+    return true;
+}
+
+size_t pattern_t::write(uploaded_string* output, size_t capacity) {
+    const size_t count = size_t(std::min<uint64_t>(capacity, idx));
+
+    if (generator == nullptr) {
+        for (size_t i = 0; i < count; ++i)
+            write(output[i]);
+
+        return count;
+    }
+
+    // The generator does not keep the odometer up to date; skip what it wrote instead.
+    const uint64_t first = next_index();
+    if (count != 0) {
+        generator(program, first, output, count);
+        advance(count);
+    }
+
+    return count;
+}
+
+bool pattern_t::write(char* storage, size_t& length) {
+    if (!has_next())
+        return false;
+
+    memcpy(storage, current.data(), current_length);
+    length = current_length;
+
+    // Nothing to move on to after the last value.
+    if (--idx > 0)
+        unchanged = advance();
+
+    return true;
+}
+
+bool pattern_t::write(uploaded_string& output, lookup3_incremental& hasher) {
+    size_t shared = unchanged;
+    if (!write(output))
+        return false;
+
+    output.hash = hasher.hash(output.words, size_t(output.char_count), shared);
     return true;
 }
@@ -1,53 +1,34 @@
 #pragma once
 
-#include "string_view_range.hpp"
 #include "uploaded_string.hpp"
+#include "lookup3_incremental.hpp"
 #include "rolling_iterator.hpp"
+#include "pattern_generators.hpp"
+#include "uint128.hpp"
+#include "wordlist.hpp"
+#include "mangling_rules.hpp"
 
 #include <cstdint>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <algorithm>
 #include <set>
+#include <string>
 #include <string_view>
 #include <cctype>
-#include <functional>
 
+struct pattern_program;
+
+// Nodes are only used to parse a pattern; pattern_t::load() compiles them into a pattern_program
+// and discards them.
 struct node_t {
     virtual ~node_t() { }
 
-    virtual size_t apply(char* storage, size_t offset) = 0;
     virtual std::string_view parse(std::string_view view) = 0;
 
-    virtual void reset() = 0;
-    virtual bool has_next() = 0;
-    virtual void move_next() = 0;
-
-    virtual uint64_t count() = 0;
-
-    node_t* next = nullptr;
-    node_t* prev = nullptr;
-
-    bool locked() const {
-        return l;
-    }
-    void lock() {
-        l = true;
-    }
-    void unlock() {
-        l = false;
-    }
-
-    size_t end_offset() const { return (prev == nullptr ? 0 : prev->end_offset()) + length(); }
-    size_t start_offset() const { return prev == nullptr ? 0 : prev->end_offset(); }
-
-    virtual std::string_view current() const = 0;
-
-protected:
-    virtual size_t length() const = 0;
-
-    bool l = false;
+    // Appends the step(s) enumerating the values of this node to program.
+    virtual void compile(pattern_program& program) const = 0;
 };
 
 // raw characters
@@ -55,21 +36,11 @@ struct raw_range_t final : public node_t {
     virtual ~raw_range_t() { }
 
 private:
-    std::vector<std::string> val;
+    std::string val;
 
 public:
-    size_t apply(char* storage, size_t offset) override;
     std::string_view parse(std::string_view view) override;
-
-    void reset() override { }
-    bool has_next() override { return false; }
-    void move_next() override { }
-
-	uint64_t count() override { return 1; }
-
-    std::string_view current() const override { return std::string_view(val[0].data(), val[0].size()); }
-
-    size_t length() const override { return val[0].size(); }
+    void compile(pattern_program& program) const override;
 };
 
 // size modifier {x, y} {x}
@@ -90,20 +61,10 @@ struct array_range_t final : public size_specified_range_t {
 
 private:
     std::vector<std::string> vals;
-    decltype(vals)::const_iterator itr;
 
 public:
-    size_t apply(char* storage, size_t offset) override;
     std::string_view parse(std::string_view view) override;
-
-    void reset() override;
-    bool has_next() override;
-    void move_next() override;
-
-	uint64_t count() override { return vals.size(); }
-
-    std::string_view current() const override { return std::string_view(itr->data(), itr->size()); }
-    size_t length() const override { return itr->size(); }
+    void compile(pattern_program& program) const override;
 };
 
 // ranges [a-z|alpha|alnum|num|hex|path]
@@ -113,89 +74,233 @@ struct varying_range_t : public size_specified_range_t {
 private:
     std::set<char> universe;
 
-    rolling_iterator<decltype(universe)::const_iterator> itr;
+public:
+    std::string_view parse(std::string_view view) override;
+    void compile(pattern_program& program) const override;
+};
+
+// dictionary {file.txt}: every word of a wordlist, see wordlist.
+// {file.txt|rules.txt}: every word of a wordlist, mangled by every rule of a file, see mangling_rules.
+struct dictionary_range_t final : public node_t {
+    virtual ~dictionary_range_t() { }
+
+private:
+    std::string path;
+    std::string rules;
 
 public:
-    size_t apply(char* storage, size_t offset) override;
     std::string_view parse(std::string_view view) override;
-    void reset() override;
-    bool has_next() override;
-    void move_next() override;
+    void compile(pattern_program& program) const override;
+};
+
+// One node of a compiled pattern.
+struct pattern_step {
+    enum kind_t : uint32_t {
+        literal = 0,
+        array = 1,
+        varying = 2,
+        dictionary = 3,
+        mangled = 4,
+    };
+
+    kind_t kind;
+
+    // literal: offset of the characters in pattern_program::characters, and their count.
+    // array: index of the first value in pattern_program::values, and the number of values.
+    // varying: offset of the alphabet in pattern_program::characters, and its size.
+    // dictionary: index of the wordlist in pattern_program::wordlists, and its number of words.
+    // mangled: same as dictionary.
+    uint32_t data;
+    uint32_t size;
+
+    // mangled only: index of the rules in pattern_program::rules.
+    uint32_t rules = 0;
+
+    // varying only.
+    uint32_t min_length = 0;
+    uint32_t max_length = 0;
+
+    // Number of values of the step; saturates at the largest uint64_t, see
+    // pattern_program::exact_count().
+    uint64_t count = 1;
+
+    // Lengths of its shortest and longest values.
+    size_t shortest = 0;
+    size_t longest = 0;
+
+    // Whether the step picks one of a list of values, see pattern_program::value().
+    bool listed() const { return kind == array || kind == dictionary; }
+};
+
+// Flat form of a pattern: every character it can produce lives in one string, and every node is a
+// plain record referring to it.
+struct pattern_program {
+    std::vector<pattern_step> steps;
+    std::string characters;
+
+    // Values of array steps, as (offset in characters, length).
+    std::vector<std::pair<uint32_t, uint32_t>> values;
 
-	uint64_t count() override;
+    // Words of dictionary steps, which stay in their files.
+    std::vector<std::shared_ptr<const wordlist>> wordlists;
 
-    std::string_view current() const override { return std::string_view(itr.current(), itr.size()); }
-    size_t length() const override { return itr.size(); }
+    // Rules of mangled steps.
+    std::vector<std::shared_ptr<const mangling_rules>> rules;
+
+    void add_literal(std::string_view value);
+    void add_array(std::vector<std::string> const& values);
+    void add_varying(std::string_view alphabet, size_t min_length, size_t max_length);
+    void add_dictionary(std::shared_ptr<const wordlist> words);
+    void add_mangled(std::shared_ptr<const wordlist> words, std::shared_ptr<const mangling_rules> rules);
+
+    // Number of values of the whole pattern; throws if it does not fit in 64 bits, which
+    // pattern_t cannot enumerate.
+    uint64_t count() const;
+
+    // Same as count(), for patterns of any size; throws past 2^128.
+    uint128 exact_count() const;
+
+    static uint128 step_count(pattern_step const& step);
+
+    // Length of its longest value.
+    size_t longest() const;
+
+    std::string_view string(uint32_t offset, uint32_t length) const {
+        return std::string_view(characters.data() + offset, length);
+    }
+
+    // index-th value of an array or dictionary step; both are enumerated the same way otherwise.
+    std::string_view value(pattern_step const& step, uint32_t index) const {
+        if (step.kind == pattern_step::dictionary)
+            return (*wordlists[step.data])[index];
+
+        auto [offset, length] = values[step.data + index];
+        return string(offset, length);
+    }
+
+    // Writes the index-th value of a mangled step to output, which must have room for
+    // uploaded_string::max_length characters; returns its length. Values of a rule are consecutive:
+    // the word varies fastest.
+    size_t mangle(pattern_step const& step, uint64_t index, char* output) const {
+        std::string_view word = (*wordlists[step.data])[size_t(index % step.size)];
+        return rules[step.rules]->apply(size_t(index / step.size), word, output);
+    }
 };
 
 struct pattern_t {
 private:
-    node_t* head = nullptr;
-    node_t* tail = nullptr;
-
-    rolling_iterator<std::vector<std::vector<char>>::const_iterator> ritr;
+    pattern_program program;
+    uint64_t total = 0;
+
+    // Index the enumeration stops at; total unless limit() says otherwise.
+    uint64_t end = 0;
+
+    // Number of values each step's value stays the same for, in step order.
+    std::vector<uint64_t> strides;
+
+    // Odometer over the steps, the last one varying fastest: array steps own a single digit,
+    // mangled steps two (word, then rule), and varying steps one rolling_iterator over the
+    // characters of their current length.
+    std::vector<uint32_t> digits;
+    std::vector<rolling_iterator> odometers;
+
+    // Index of each step's (first) digit (array, mangled) or odometer (varying), and where its
+    // characters currently are in current.
+    struct step_state {
+        uint32_t digit;
+        uint32_t start;
+        uint32_t length;
+    };
+    std::vector<step_state> states;
+
+    // Characters of the value the next call to write() produces.
+    std::vector<char> current;
+    size_t current_length = 0;
+
+    // Number of values left to write.
 	uint64_t idx = 0;
 
+    // Number of leading characters the next value shares with the last one written.
+    size_t unchanged = 0;
+
+    // Index of the last step that is not a literal; the number of steps if there is none.
+    size_t tail = 0;
+
+    // Used by the batch write() if the pattern has a known shape; see pattern_generators.
+    pattern_generator generator = nullptr;
+
+    // Moves to the next value; returns the offset of the first character that changed.
+    size_t advance();
+
+    // Writes the characters of steps from first_step on to current, starting from character
+    // first_char of the first of them; literals are only written again if they moved.
+    void render(size_t first_step, size_t first_char);
+
 public:
+    pattern_t() = default;
+
     pattern_t(std::string_view regex);
 
     void load(std::string_view regex);
 
-    pattern_t() {
-        head = nullptr;
-        tail = nullptr;
+    // Parses a pattern without preparing to enumerate it, so that patterns too large or too long
+    // for load() can still be counted.
+    static pattern_program compile(std::string_view regex);
 
-    }
+    pattern_program const& compiled() const { return program; }
 
-    pattern_t(pattern_t&& o) {
-        head = o.head;
-        tail = o.tail;
+	uint64_t count() const { return total; }
 
-    }
+    bool has_next() const { return idx > 0; }
 
-    pattern_t(pattern_t const& o) {
-        head = o.head;
-        tail = o.tail;
+    // Index of the value the next call to write() produces; the end of the enumeration once it
+    // ended.
+    uint64_t next_index() const { return end - idx; }
 
-    }
+    // Values are numbered in the order write() produces them: the last node varies fastest.
 
-    pattern_t& operator = (pattern_t&& o) {
-        reset();
+    // Makes the next call to write() produce the value at index, in O(number of nodes). Seeking
+    // to count() or past it ends the enumeration.
+    void seek(uint64_t index);
 
-        head = o.head;
-        tail = o.tail;
+    // Skips the next n values, as seek(next_index() + n) would, but by adding n to the digits of
+    // the steps and carrying from one step to the next: only the steps that change are updated,
+    // which makes moving a little ahead cheaper than seeking.
+    void advance(uint64_t n);
 
-        return *this;
-    }
+    // Ends the enumeration before the value at index last, for this pattern and until the next
+    // load(); seeking to it or past it then ends the enumeration as well.
+    void limit(uint64_t last);
 
-    ~pattern_t() {
-        reset();
-        tail = nullptr;
-    }
-
-    void reset()
-    {
-        //TODO: blowing up the stack here would be fun; wouldn't it?
-        std::function<void(node_t*)> last_deleter;
-        last_deleter = [&](node_t* node) -> void {
-            if (node->next != nullptr) {
-                last_deleter(node->next);
-                node->next = nullptr;
-            }
-            delete node;
-        };
-
-        if (head == nullptr)
-            return;
-
-        last_deleter(head);
-        head = tail = nullptr;
-    }
+    // Writes the value at index to output without changing the enumeration state. Returns false
+    // if index is not less than count().
+    bool write_at(uint64_t index, uploaded_string& output) const;
 
-	uint64_t count() const;
+    // Constant leading characters shared by every value of the pattern; empty if the pattern
+    // starts with a varying node.
+    std::string_view prefix() const;
 
-    bool has_next() const;
+    // Values come in runs that only differ from the last node that is not a literal on: in
+    // '{dirs}/{files}.ADT', every file of a directory. head() holds the characters the next value
+    // shares with the rest of its run, and run_remaining() the number of values left in the run,
+    // that one included.
+    std::string_view head() const;
+    uint64_t run_remaining() const;
 
+    // Writes the next value to output, which must hold a string built by uploaded_string; only
+    // the bytes of its previous value past the end of the new one are cleared.
     bool write(uploaded_string& output);
-};
 
+    // Writes up to capacity values to output, as that many calls to write() would; returns how many.
+    // Patterns of a common shape are written by a generator specialized for it.
+    size_t write(uploaded_string* output, size_t capacity);
+
+    // Same as write(), but stores the characters of the value in storage, which must have room
+    // for uploaded_string::max_length of them, and their count in length.
+    bool write(char* storage, size_t& length);
+
+    // Same as write(), but also stores the hash of the value in output. hasher only re-mixes the
+    // blocks that changed since the previous value; it must not be used for anything else while
+    // this pattern is being enumerated.
+    bool write(uploaded_string& output, lookup3_incremental& hasher);
+};
@@ -0,0 +1,591 @@
+#include "pattern_dedup.hpp"
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <set>
+
+namespace {
+    // One node of a compiled pattern, in a form where nodes producing the same values compare
+    // equal: alternations have no repeats, single values are literals and literals are merged.
+    struct keyspace_step {
+        pattern_step::kind_t kind = pattern_step::literal;
+
+        std::string literal;
+
+        // array: values in enumeration order, and sorted for lookups.
+        std::vector<std::string> values;
+        std::vector<std::string> sorted;
+
+        // array: path of the wordlist the values come from, if they do; such steps are spelled
+        // as {path} again, and never narrowed down.
+        // mangled: path of the wordlist, and of the rules; the values are never listed, and only
+        // compare equal to those of the same files.
+        std::string wordlist;
+        std::string rules;
+        uint64_t count = 0;
+
+        // varying: sorted characters, and the range of lengths.
+        std::string alphabet;
+        uint32_t min_length = 0;
+        uint32_t max_length = 0;
+    };
+
+    using keyspace = std::vector<keyspace_step>;
+
+    keyspace_step make_literal(std::string value) {
+        keyspace_step step;
+        step.kind = pattern_step::literal;
+        step.literal = std::move(value);
+        return step;
+    }
+
+    keyspace_step make_array(std::vector<std::string> values) {
+        keyspace_step step;
+        step.kind = pattern_step::array;
+        step.values = std::move(values);
+        step.sorted = step.values;
+        std::sort(step.sorted.begin(), step.sorted.end());
+        return step;
+    }
+
+    keyspace_step make_varying(std::string alphabet, uint32_t min_length, uint32_t max_length) {
+        keyspace_step step;
+        step.kind = pattern_step::varying;
+        step.alphabet = std::move(alphabet);
+        step.min_length = min_length;
+        step.max_length = max_length;
+        return step;
+    }
+
+    // Brings steps to their canonical form.
+    void simplify(keyspace& steps) {
+        keyspace simplified;
+        for (keyspace_step& step : steps) {
+            if (step.kind == pattern_step::array && step.values.size() == 1)
+                step = make_literal(step.values[0]);
+            else if (step.kind == pattern_step::varying && step.max_length == 0)
+                continue;
+            else if (step.kind == pattern_step::varying && step.alphabet.size() == 1 && step.min_length == step.max_length)
+                step = make_literal(std::string(step.min_length, step.alphabet[0]));
+
+            if (step.kind == pattern_step::literal) {
+                if (step.literal.empty())
+                    continue;
+
+                if (!simplified.empty() && simplified.back().kind == pattern_step::literal) {
+                    simplified.back().literal += step.literal;
+                    continue;
+                }
+            }
+
+            simplified.push_back(std::move(step));
+        }
+
+        steps = std::move(simplified);
+    }
+
+    keyspace canonical(pattern_program const& program) {
+        keyspace steps;
+        for (pattern_step const& step : program.steps) {
+            switch (step.kind) {
+            case pattern_step::literal:
+                steps.push_back(make_literal(std::string(program.string(step.data, step.size))));
+                break;
+            case pattern_step::array: {
+                std::set<std::string> seen;
+                std::vector<std::string> values;
+                for (uint32_t i = 0; i < step.size; ++i) {
+                    auto [offset, length] = program.values[step.data + i];
+
+                    std::string value(program.string(offset, length));
+                    if (seen.insert(value).second)
+                        values.push_back(std::move(value));
+                }
+
+                steps.push_back(make_array(std::move(values)));
+                break;
+            }
+            case pattern_step::dictionary: {
+                // Words are kept as they are, repeats included, so that the step is spelled again
+                // as the same file.
+                std::vector<std::string> values;
+                for (uint32_t i = 0; i < step.size; ++i)
+                    values.emplace_back(program.value(step, i));
+
+                steps.push_back(make_array(std::move(values)));
+                steps.back().wordlist = program.wordlists[step.data]->path();
+                break;
+            }
+            case pattern_step::mangled: {
+                keyspace_step mangled;
+                mangled.kind = pattern_step::mangled;
+                mangled.wordlist = program.wordlists[step.data]->path();
+                mangled.rules = program.rules[step.rules]->path();
+                mangled.count = step.count;
+
+                steps.push_back(std::move(mangled));
+                break;
+            }
+            case pattern_step::varying:
+                // Alphabets come out of a std::set, and are already sorted.
+                steps.push_back(make_varying(std::string(program.string(step.data, step.size)), step.min_length, step.max_length));
+                break;
+            }
+        }
+
+        simplify(steps);
+        return steps;
+    }
+
+    double count(keyspace const& steps) {
+        double total = 1;
+        for (keyspace_step const& step : steps) {
+            if (step.kind == pattern_step::array)
+                total *= double(step.values.size());
+            else if (step.kind == pattern_step::mangled)
+                total *= double(step.count);
+            else if (step.kind == pattern_step::varying) {
+                double values = 0;
+                for (uint32_t length = step.min_length; length <= step.max_length; ++length)
+                    values += std::pow(double(step.alphabet.size()), double(length));
+
+                total *= values;
+            }
+        }
+        return total;
+    }
+
+    bool same_step(keyspace_step const& lhs, keyspace_step const& rhs) {
+        if (lhs.kind != rhs.kind)
+            return false;
+
+        switch (lhs.kind) {
+        case pattern_step::literal:
+            return lhs.literal == rhs.literal;
+        case pattern_step::array:
+            return lhs.sorted == rhs.sorted;
+        case pattern_step::mangled:
+            return lhs.wordlist == rhs.wordlist && lhs.rules == rhs.rules;
+        default:
+            return lhs.alphabet == rhs.alphabet && lhs.min_length == rhs.min_length && lhs.max_length == rhs.max_length;
+        }
+    }
+
+    // Whether outer produces value.
+    bool produces(keyspace_step const& outer, std::string const& value) {
+        switch (outer.kind) {
+        case pattern_step::literal:
+            return outer.literal == value;
+        case pattern_step::array:
+            return std::binary_search(outer.sorted.begin(), outer.sorted.end(), value);
+        case pattern_step::mangled:
+            // Not known without mangling every word; assumed not to.
+            return false;
+        default:
+            if (value.size() < outer.min_length || value.size() > outer.max_length)
+                return false;
+
+            for (char c : value)
+                if (!std::binary_search(outer.alphabet.begin(), outer.alphabet.end(), c))
+                    return false;
+
+            return true;
+        }
+    }
+
+    // Whether every value of inner is a value of outer.
+    bool contains(keyspace_step const& outer, keyspace_step const& inner) {
+        switch (inner.kind) {
+        case pattern_step::literal:
+            return produces(outer, inner.literal);
+        case pattern_step::array:
+            return std::all_of(inner.values.begin(), inner.values.end(), [&outer](std::string const& value) {
+                return produces(outer, value);
+            });
+        case pattern_step::mangled:
+            return same_step(outer, inner);
+        default:
+            return outer.kind == pattern_step::varying
+                && outer.min_length <= inner.min_length && inner.max_length <= outer.max_length
+                && std::includes(outer.alphabet.begin(), outer.alphabet.end(), inner.alphabet.begin(), inner.alphabet.end());
+        }
+    }
+
+    // Whether steps, from first on, produce value.
+    bool matches(keyspace const& steps, size_t first, std::string_view value) {
+        if (first == steps.size())
+            return value.empty();
+
+        keyspace_step const& step = steps[first];
+        switch (step.kind) {
+        case pattern_step::literal:
+            return value.substr(0, step.literal.size()) == step.literal && matches(steps, first + 1, value.substr(step.literal.size()));
+        case pattern_step::array:
+            for (std::string const& alternative : step.values)
+                if (value.substr(0, alternative.size()) == alternative && matches(steps, first + 1, value.substr(alternative.size())))
+                    return true;
+
+            return false;
+        case pattern_step::mangled:
+            return false;
+        default:
+            for (size_t length = 0; length <= step.max_length && length <= value.size(); ++length) {
+                if (length >= step.min_length && matches(steps, first + 1, value.substr(length)))
+                    return true;
+
+                if (length < value.size() && !std::binary_search(step.alphabet.begin(), step.alphabet.end(), value[length]))
+                    return false;
+            }
+
+            return false;
+        }
+    }
+
+    // Calls f with every value of steps, from first on, appended to value, until f returns false.
+    template <typename F>
+    bool enumerate(keyspace const& steps, size_t first, std::string& value, F const& f) {
+        if (first == steps.size())
+            return f(value);
+
+        const size_t length = value.size();
+        auto next = [&](std::string_view characters) {
+            value += characters;
+            bool more = enumerate(steps, first + 1, value, f);
+            value.resize(length);
+            return more;
+        };
+
+        keyspace_step const& step = steps[first];
+        switch (step.kind) {
+        case pattern_step::literal:
+            return next(step.literal);
+        case pattern_step::array:
+            for (std::string const& alternative : step.values)
+                if (!next(alternative))
+                    return false;
+
+            return true;
+        default:
+            for (uint32_t count = step.min_length; count <= step.max_length; ++count) {
+                // Odometer over the characters of this length.
+                std::vector<size_t> digits(count, 0);
+                std::string characters(count, step.alphabet[0]);
+                while (true) {
+                    if (!next(characters))
+                        return false;
+
+                    size_t i = count;
+                    while (i > 0 && ++digits[i - 1] == step.alphabet.size()) {
+                        digits[i - 1] = 0;
+                        characters[i - 1] = step.alphabet[0];
+                        --i;
+                    }
+
+                    if (i == 0)
+                        break;
+
+                    characters[i - 1] = step.alphabet[digits[i - 1]];
+                }
+            }
+
+            return true;
+        }
+    }
+
+    // Lines of up to this many values are also compared value by value, which catches values
+    // spread over a different number of nodes, such as ABC against A(B|C)C.
+    constexpr const double max_enumerated = 256;
+
+    // Whether every value of inner is a value of outer.
+    bool contains(keyspace const& outer, keyspace const& inner) {
+        if (outer.size() == inner.size()) {
+            bool contained = true;
+            for (size_t i = 0; i < outer.size() && contained; ++i)
+                contained = contains(outer[i], inner[i]);
+
+            if (contained)
+                return true;
+        }
+
+        if (count(inner) > max_enumerated)
+            return false;
+
+        // Mangled values are not enumerated, see matches().
+        if (std::any_of(inner.begin(), inner.end(), [](keyspace_step const& step) { return step.kind == pattern_step::mangled; }))
+            return false;
+
+        std::string value;
+        return enumerate(inner, 0, value, [&outer](std::string const& candidate) {
+            return matches(outer, 0, candidate);
+        });
+    }
+
+    // Splits the values of piece that other does not produce into pieces, if piece and other
+    // differ by a single node and the difference can be expressed; returns false otherwise.
+    bool subtract(keyspace const& piece, keyspace const& other, std::vector<keyspace>& pieces) {
+        if (piece.size() != other.size())
+            return false;
+
+        size_t differing = piece.size();
+        for (size_t i = 0; i < piece.size(); ++i) {
+            if (same_step(piece[i], other[i]))
+                continue;
+
+            if (differing != piece.size())
+                return false;
+
+            differing = i;
+        }
+
+        if (differing == piece.size())
+            return false;
+
+        keyspace_step const& step = piece[differing];
+        keyspace_step const& shared = other[differing];
+
+        if (step.kind == pattern_step::array) {
+            if (!step.wordlist.empty())
+                return false;
+
+            std::vector<std::string> remaining;
+            for (std::string const& value : step.values)
+                if (!produces(shared, value))
+                    remaining.push_back(value);
+
+            if (remaining.size() == step.values.size() || remaining.empty())
+                return false;
+
+            keyspace narrowed = piece;
+            narrowed[differing] = make_array(std::move(remaining));
+            simplify(narrowed);
+
+            pieces.push_back(std::move(narrowed));
+            return true;
+        }
+
+        if (step.kind != pattern_step::varying || shared.kind != pattern_step::varying)
+            return false;
+
+        // Values of other's lengths are all shared if other uses every character of this node.
+        if (!std::includes(shared.alphabet.begin(), shared.alphabet.end(), step.alphabet.begin(), step.alphabet.end()))
+            return false;
+
+        if (shared.max_length < step.min_length || step.max_length < shared.min_length)
+            return false;
+
+        // Lengths below and above the shared ones; neither is empty unless the node is covered.
+        auto add_lengths = [&](uint32_t min_length, uint32_t max_length) {
+            keyspace narrowed = piece;
+            narrowed[differing] = make_varying(step.alphabet, min_length, max_length);
+            simplify(narrowed);
+
+            pieces.push_back(std::move(narrowed));
+        };
+
+        const size_t first = pieces.size();
+        if (step.min_length < shared.min_length)
+            add_lengths(step.min_length, shared.min_length - 1);
+        if (shared.max_length < step.max_length)
+            add_lengths(shared.max_length + 1, step.max_length);
+
+        return pieces.size() != first;
+    }
+
+    // Spells steps back as a pattern; returns false if some characters cannot be.
+    bool unparse(keyspace const& steps, std::string& pattern) {
+        // Characters are hashed with backslashes as separators, which patterns spell as slashes.
+        auto append = [&pattern](std::string const& value, const char* escaped) {
+            for (char c : value) {
+                if (c == '\\')
+                    c = '/';
+                else if (strchr(escaped, c) != nullptr)
+                    pattern += '\\';
+
+                pattern += c;
+            }
+        };
+
+        constexpr const char path_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_. \\";
+
+        pattern.clear();
+        for (keyspace_step const& step : steps) {
+            switch (step.kind) {
+            case pattern_step::literal:
+                append(step.literal, "([{");
+                break;
+            case pattern_step::array:
+                if (!step.wordlist.empty()) {
+                    pattern += "{" + step.wordlist + "}";
+                    break;
+                }
+
+                // The parser does not split on a separator in first position.
+                if (step.values[0].empty())
+                    return false;
+
+                pattern += '(';
+                for (size_t i = 0; i < step.values.size(); ++i) {
+                    if (i != 0)
+                        pattern += '|';
+
+                    append(step.values[i], "|)");
+                }
+                pattern += ')';
+                break;
+            case pattern_step::varying: {
+                std::string remaining = step.alphabet;
+                std::vector<std::string> ranges;
+
+                // Dashes and backslashes can only be spelled as part of path.
+                std::string path(path_alphabet);
+                std::sort(path.begin(), path.end());
+                if (std::includes(remaining.begin(), remaining.end(), path.begin(), path.end())) {
+                    ranges.push_back("path");
+
+                    std::string rest;
+                    std::set_difference(remaining.begin(), remaining.end(), path.begin(), path.end(), std::back_inserter(rest));
+                    remaining = std::move(rest);
+                }
+
+                // Runs of consecutive characters.
+                for (size_t i = 0; i < remaining.size(); ) {
+                    char c = remaining[i];
+                    if (c == '-' || c == '\\' || c == '|' || c == ']' || std::islower(static_cast<unsigned char>(c)))
+                        return false;
+
+                    size_t end = i + 1;
+                    while (end < remaining.size() && remaining[end] == remaining[end - 1] + 1
+                        && remaining[end] != '-' && remaining[end] != '\\' && remaining[end] != '|' && remaining[end] != ']')
+                        ++end;
+
+                    ranges.push_back(std::string{ c, '-', remaining[end - 1] });
+                    i = end;
+                }
+
+                pattern += '[';
+                for (size_t i = 0; i < ranges.size(); ++i) {
+                    if (i != 0)
+                        pattern += '|';
+
+                    pattern += ranges[i];
+                }
+                pattern += "]{" + std::to_string(step.min_length);
+                if (step.max_length != step.min_length)
+                    pattern += "," + std::to_string(step.max_length);
+                pattern += '}';
+                break;
+            }
+            case pattern_step::dictionary:
+                // canonical() turns wordlists into arrays.
+                return false;
+            case pattern_step::mangled:
+                pattern += "{" + step.wordlist + "|" + step.rules + "}";
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    struct entry_t {
+        size_t source;
+        keyspace steps;
+
+        bool compiled = false;     // false if the line did not compile, and steps is empty
+        bool rewritten = false;    // true if the line must be spelled again from steps
+        bool dropped = false;      // true if a later line produces all of its values
+    };
+}
+
+std::vector<std::string> deduplicate_patterns(std::vector<std::string> const& patterns, dedup_stats& stats)
+{
+    std::vector<entry_t> entries;
+    std::vector<double> original_counts(patterns.size(), 0.0);
+
+    for (size_t source = 0; source < patterns.size(); ++source) {
+        keyspace steps;
+        try {
+            pattern_t parsed(patterns[source]);
+
+            steps = canonical(parsed.compiled());
+            original_counts[source] = double(parsed.count());
+        }
+        catch (std::exception const&) {
+            // Left for input_file to report.
+            entries.push_back(entry_t{ source, keyspace() });
+            continue;
+        }
+
+        stats.values_before += original_counts[source];
+
+        // Lines that cannot be spelled again can still be skipped, but not rewritten.
+        std::string spelled;
+        const bool rewritable = unparse(steps, spelled);
+        const bool repeats = rewritable && count(steps) != original_counts[source];
+
+        std::vector<keyspace> pieces{ std::move(steps) };
+        bool narrowed = false;
+
+        for (entry_t& other : entries) {
+            if (!other.compiled || other.dropped)
+                continue;
+
+            std::vector<keyspace> remaining;
+            for (keyspace& piece : pieces) {
+                if (contains(other.steps, piece))
+                    continue;
+
+                if (rewritable && subtract(piece, other.steps, remaining)) {
+                    narrowed = true;
+                    continue;
+                }
+
+                if (contains(piece, other.steps))
+                    other.dropped = true;
+
+                remaining.push_back(std::move(piece));
+            }
+
+            pieces = std::move(remaining);
+        }
+
+        for (keyspace& piece : pieces) {
+            entry_t entry{ source, std::move(piece) };
+            entry.compiled = true;
+            entry.rewritten = repeats || narrowed;
+
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    std::vector<std::string> deduplicated;
+    std::vector<bool> emitted(patterns.size(), false);
+    std::vector<bool> rewritten(patterns.size(), false);
+
+    for (entry_t const& entry : entries) {
+        if (entry.dropped)
+            continue;
+
+        emitted[entry.source] = true;
+        if (!entry.rewritten) {
+            deduplicated.push_back(patterns[entry.source]);
+            stats.values_after += original_counts[entry.source];
+            continue;
+        }
+
+        std::string spelled;
+        unparse(entry.steps, spelled);
+
+        deduplicated.push_back(std::move(spelled));
+        stats.values_after += count(entry.steps);
+        rewritten[entry.source] = true;
+    }
+
+    stats.skipped += std::count(emitted.begin(), emitted.end(), false);
+    stats.rewritten += std::count(rewritten.begin(), rewritten.end(), true);
+    return deduplicated;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Outcome of deduplicate_patterns().
+struct dedup_stats {
+    size_t skipped = 0;          // lines whose values all come out of other lines
+    size_t rewritten = 0;        // lines narrowed down, or split, so as not to repeat other lines
+
+    // Number of values of the lines before and after; lines that do not compile are not counted.
+    double values_before = 0;
+    double values_after = 0;
+};
+
+// Rewrites a list of patterns so that values produced by more than one of them are only produced
+// once, keeping them in the same order otherwise. Patterns are compared node by node once compiled,
+// which catches:
+//   lines that produce the same values, however they are spelled: only the first one is kept;
+//   lines whose values are all produced by another line, in which case the narrower one is skipped;
+//   lines that differ from an earlier one by a single node, when that node is an alternation that
+//   shares values with the earlier one, or a range over (a subset of) the same characters whose
+//   lengths overlap: the later line is rewritten without the shared values, split in two if needed;
+//   repeated values within an alternation.
+// Other overlaps are left alone. Lines that fail to compile are passed through as is.
+std::vector<std::string> deduplicate_patterns(std::vector<std::string> const& patterns, dedup_stats& stats);
@@ -0,0 +1,170 @@
+#include "pattern_descriptor.hpp"
+#include "pattern.hpp"
+
+#include <stdexcept>
+
+pattern_descriptor::pattern_descriptor(std::string_view pattern) : _pattern(pattern)
+{
+    pattern_t parsed(pattern);
+    pattern_program const& program = parsed.compiled();
+
+    std::vector<pattern_step> const& nodes = program.steps;
+    _count = parsed.count();
+
+    if (nodes.size() > max_nodes)
+        throw std::runtime_error("Pattern has too many nodes to be generated on the device");
+
+    // Array tables come first so that they are word-aligned; characters follow.
+    size_t table_words = 0;
+    for (pattern_step const& node : nodes)
+        if (node.listed())
+            table_words += node.size * 2;
+
+    const size_t data_word = header_words + nodes.size() * node_words;
+    size_t next_table = data_word;
+
+    auto too_large = [&]() {
+        return std::runtime_error("Pattern '" + _pattern + "' is too large to be generated on the device: patterns are limited to "
+            "64 KiB, wordlists included; hash this pattern without --generate");
+    };
+
+    // Checked again once the characters are in; this catches large wordlists before they are copied.
+    if (data_word + table_words > max_words)
+        throw too_large();
+
+    std::string bytes;
+    auto append_bytes = [&](std::string_view value) -> uint32_t {
+        uint32_t offset = uint32_t((data_word + table_words) * sizeof(uint32_t) + bytes.size());
+        bytes += value;
+        return offset;
+    };
+
+    _words.assign(data_word + table_words, 0);
+    _words[0] = uint32_t(nodes.size());
+    _words[2] = uint32_t(_count);
+    _words[3] = uint32_t(_count >> 32);
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        pattern_step const& node = nodes[i];
+        uint32_t* record = _words.data() + header_words + i * node_words;
+
+        record[1] = uint32_t(node.count);
+        record[2] = uint32_t(node.count >> 32);
+
+        switch (node.kind) {
+        case pattern_step::literal:
+            record[0] = raw;
+            record[3] = append_bytes(program.string(node.data, node.size));
+            record[4] = node.size;
+            break;
+        case pattern_step::array:
+        case pattern_step::dictionary:
+            // The device cannot see mapped wordlists; their words are copied like alternatives.
+            record[0] = array;
+            record[3] = uint32_t(next_table);
+            record[4] = node.size;
+            for (uint32_t v = 0; v < node.size; ++v) {
+                std::string_view value = program.value(node, v);
+
+                _words[next_table++] = append_bytes(value);
+                _words[next_table++] = uint32_t(value.size());
+            }
+            break;
+        case pattern_step::mangled:
+            // Rules would need an interpreter in jenkins.comp; such patterns are uploaded instead.
+            throw std::runtime_error("Mangled wordlists cannot be generated on the device; hash this pattern without --generate");
+        case pattern_step::varying:
+            record[0] = varying;
+            record[3] = append_bytes(program.string(node.data, node.size));
+            record[4] = node.size;
+            record[5] = node.min_length;
+            record[6] = node.max_length;
+            break;
+        }
+    }
+
+    if (_words.size() + (bytes.size() + 3) / 4 > max_words)
+        throw too_large();
+
+    _words.resize(_words.size() + (bytes.size() + 3) / 4, 0);
+    memcpy(_words.data() + data_word + table_words, bytes.data(), bytes.size());
+}
+
+void pattern_descriptor::write_at(uint64_t index, uploaded_string& output) const
+{
+    const uint32_t node_count = _words[0];
+
+    // Digit of every node; for varying nodes, the index among the values of their own length.
+    uint64_t digits[max_nodes];
+    uint32_t lengths[max_nodes];
+
+    for (uint32_t n = node_count; n-- > 0; ) {
+        const uint32_t* record = _words.data() + header_words + n * node_words;
+
+        uint64_t count = uint64_t(record[1]) | (uint64_t(record[2]) << 32);
+        uint64_t digit = index % count;
+        index /= count;
+
+        switch (record[0]) {
+        case raw:
+            lengths[n] = record[4];
+            break;
+        case array:
+            lengths[n] = _words[record[3] + digit * 2 + 1];
+            break;
+        case varying: {
+            uint32_t length = record[5];
+
+            uint64_t power = 1;
+            for (uint32_t i = 0; i < length; ++i)
+                power *= record[4];
+
+            while (digit >= power) {
+                digit -= power;
+                power *= record[4];
+                ++length;
+            }
+
+            lengths[n] = length;
+            break;
+        }
+        }
+
+        digits[n] = digit;
+    }
+
+    char value[uploaded_string::max_length];
+    size_t size = 0;
+
+    for (uint32_t n = 0; n < node_count; ++n) {
+        const uint32_t* record = _words.data() + header_words + n * node_words;
+
+        switch (record[0]) {
+        case raw:
+            for (uint32_t i = 0; i < lengths[n]; ++i)
+                value[size++] = char(byte_at(record[3] + i));
+            break;
+        case array: {
+            uint32_t offset = _words[record[3] + digits[n] * 2];
+            for (uint32_t i = 0; i < lengths[n]; ++i)
+                value[size++] = char(byte_at(offset + i));
+            break;
+        }
+        case varying: {
+            // First character is the most significant digit.
+            uint64_t divisor = 1;
+            for (uint32_t i = 1; i < lengths[n]; ++i)
+                divisor *= record[4];
+
+            for (uint32_t i = 0; i < lengths[n]; ++i) {
+                value[size++] = char(byte_at(record[3] + uint32_t((digits[n] / divisor) % record[4])));
+                divisor /= record[4];
+            }
+            break;
+        }
+        }
+    }
+
+    output.reset();
+    output.append(std::string_view(value, size));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "uploaded_string.hpp"
+
+// Flat encoding of a pattern, from which any of its values can be produced given its index, either
+// on the host or by jenkins.comp when built with GENERATE_CANDIDATES.
+//
+// Values are numbered in odometer order: the last node varies fastest. A varying range enumerates
+// its shorter lengths first and, for a given length, its last character fastest. An index is split
+// into one digit per node by dividing it by the number of values of each node in turn, starting
+// from the last one.
+//
+// Layout, in 32-bit words:
+//   node count, reserved, total count (low, high)
+//   one record of node_words words per node: kind, count (low, high), data, a, b, c, reserved
+//   data of every node
+// where, depending on kind:
+//   raw      data is the byte offset of the characters, a their count
+//   array    data is the word offset of a table of (byte offset, length) pairs, a the number of pairs;
+//            wordlists are copied into such tables as well
+//   varying  data is the byte offset of the alphabet, a its size, b and c the minimum and maximum length
+// Offsets are relative to the start of the descriptor. Mangled wordlists have no encoding, see
+// mangling_rules.
+class pattern_descriptor {
+public:
+    enum node_kind : uint32_t {
+        raw = 0,
+        array = 1,
+        varying = 2,
+    };
+
+    constexpr static const size_t header_words = 4;
+    constexpr static const size_t node_words = 8;
+
+    // Must match MAX_NODES in jenkins.comp.
+    constexpr static const size_t max_nodes = 16;
+
+    // Largest descriptor the device is given, in words. The generator buffer of a frame is 64 KiB
+    // and starts with the four words of the frame header, see jenkins.comp. Since wordlists are
+    // copied into the descriptor, this bounds the size of the wordlists of a pattern as well.
+    constexpr static const size_t max_words = 64 * 1024 / sizeof(uint32_t) - 4;
+
+    // Throws if the pattern cannot be generated on the device: mangled wordlists, more than
+    // max_nodes nodes, or more than max_words words.
+    explicit pattern_descriptor(std::string_view pattern);
+
+    std::string const& pattern() const { return _pattern; }
+
+    uint64_t count() const { return _count; }
+
+    // Writes the value at index, which must be less than count(), to output.
+    void write_at(uint64_t index, uploaded_string& output) const;
+
+    std::vector<uint32_t> const& words() const { return _words; }
+
+private:
+    std::string _pattern;
+    uint64_t _count = 1;
+
+    std::vector<uint32_t> _words;
+
+    uint32_t byte_at(uint32_t offset) const {
+        return (_words[offset >> 2] >> ((offset & 3) * 8)) & 0xFF;
+    }
+};
@@ -0,0 +1,212 @@
+#include "pattern_generators.hpp"
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <string_view>
+
+namespace {
+    // Literals around the step that varies.
+    struct shape_t {
+        std::string_view prefix;
+        pattern_step const* step = nullptr;
+        std::string_view suffix;
+    };
+
+    bool match_shape(pattern_program const& program, shape_t& shape) {
+        std::vector<pattern_step> const& steps = program.steps;
+
+        size_t begin = 0;
+        size_t end = steps.size();
+
+        if (begin < end && steps[begin].kind == pattern_step::literal) {
+            shape.prefix = program.string(steps[begin].data, steps[begin].size);
+            ++begin;
+        }
+
+        if (begin < end && steps[end - 1].kind == pattern_step::literal) {
+            shape.suffix = program.string(steps[end - 1].data, steps[end - 1].size);
+            --end;
+        }
+
+        if (end - begin != 1)
+            return false;
+
+        shape.step = &steps[begin];
+        return true;
+    }
+
+    inline void emit(uploaded_string& output, const char* value, size_t length) {
+        output.assign(std::string_view(value, length));
+    }
+
+    // prefix, Length characters out of an alphabet of Radix, suffix.
+    template <size_t Length, uint32_t Radix>
+    void generate_run(pattern_program const& program, uint64_t first, uploaded_string* output, size_t count) {
+        shape_t shape;
+        match_shape(program, shape);
+
+        const char* alphabet = program.characters.data() + shape.step->data;
+
+        // Empty literals are views with no data; copy_n copies nothing from them, unlike memcpy.
+        char value[uploaded_string::max_length];
+        std::copy_n(shape.prefix.data(), shape.prefix.size(), value);
+        std::copy_n(shape.suffix.data(), shape.suffix.size(), value + shape.prefix.size() + Length);
+
+        const size_t length = shape.prefix.size() + Length + shape.suffix.size();
+        char* run = value + shape.prefix.size();
+
+        // The last character is the least significant digit.
+        std::array<uint32_t, Length> digits;
+        for (size_t i = Length; i-- > 0; ) {
+            digits[i] = uint32_t(first % Radix);
+            run[i] = alphabet[digits[i]];
+            first /= Radix;
+        }
+
+        size_t produced = 0;
+        while (true) {
+            // Only the last character changes in the innermost loop.
+            for (uint32_t d = digits[Length - 1]; d < Radix; ++d) {
+                run[Length - 1] = alphabet[d];
+                emit(output[produced], value, length);
+
+                if (++produced == count)
+                    return;
+            }
+
+            digits[Length - 1] = 0;
+            run[Length - 1] = alphabet[0];
+
+            // Carry over to the previous characters.
+            size_t i = Length - 1;
+            while (true) {
+                if (i == 0)
+                    return;
+
+                --i;
+                if (++digits[i] < Radix) {
+                    run[i] = alphabet[digits[i]];
+                    break;
+                }
+
+                digits[i] = 0;
+                run[i] = alphabet[0];
+            }
+        }
+    }
+
+    // prefix, one of the alternatives, suffix.
+    void generate_alternatives(pattern_program const& program, uint64_t first, uploaded_string* output, size_t count) {
+        shape_t shape;
+        match_shape(program, shape);
+
+        char value[uploaded_string::max_length];
+        std::copy_n(shape.prefix.data(), shape.prefix.size(), value);
+
+        for (size_t i = 0; i < count; ++i) {
+            std::string_view alternative = program.value(*shape.step, uint32_t(first + i));
+
+            char* cursor = value + shape.prefix.size();
+            cursor = std::copy_n(alternative.data(), alternative.size(), cursor);
+            cursor = std::copy_n(shape.suffix.data(), shape.suffix.size(), cursor);
+
+            emit(output[i], value, size_t(cursor - value));
+        }
+    }
+
+    // prefix, a word of a wordlist mangled by one of a set of rules, suffix. The values of a rule
+    // are consecutive, so words go through it in batches, one function at a time.
+    void generate_mangled(pattern_program const& program, uint64_t first, uploaded_string* output, size_t count) {
+        shape_t shape;
+        match_shape(program, shape);
+
+        pattern_step const& step = *shape.step;
+        wordlist const& words = *program.wordlists[step.data];
+        mangling_rules const& rules = *program.rules[step.rules];
+
+        constexpr const size_t batch_size = 64;
+        char words_batch[batch_size][uploaded_string::max_length];
+        uint32_t lengths[batch_size];
+
+        char value[uploaded_string::max_length];
+        std::copy_n(shape.prefix.data(), shape.prefix.size(), value);
+
+        for (size_t produced = 0; produced < count; ) {
+            const uint64_t index = first + produced;
+            const size_t rule = size_t(index / step.size);
+            const uint32_t word = uint32_t(index % step.size);
+
+            // A batch stops at the last word, where the next rule starts.
+            const size_t batch = size_t(std::min<uint64_t>({ batch_size, count - produced, step.size - word }));
+            for (size_t i = 0; i < batch; ++i) {
+                std::string_view w = words[word + i];
+
+                std::copy_n(w.data(), w.size(), words_batch[i]);
+                lengths[i] = uint32_t(w.size());
+            }
+
+            rules.apply(rule, words_batch[0], sizeof(words_batch[0]), lengths, batch);
+
+            for (size_t i = 0; i < batch; ++i) {
+                char* cursor = value + shape.prefix.size();
+                cursor = std::copy_n(words_batch[i], lengths[i], cursor);
+                cursor = std::copy_n(shape.suffix.data(), shape.suffix.size(), cursor);
+
+                emit(output[produced + i], value, size_t(cursor - value));
+            }
+
+            produced += batch;
+        }
+    }
+
+    constexpr const size_t max_run_length = 8;
+
+    template <uint32_t Radix, size_t... Lengths>
+    constexpr std::array<pattern_generator, sizeof...(Lengths)> make_run_generators(std::index_sequence<Lengths...>) {
+        return { &generate_run<Lengths + 1, Radix>... };
+    }
+
+    struct run_generators_t {
+        uint32_t radix;
+        std::array<pattern_generator, max_run_length> by_length;
+    };
+
+    // Alphabet sizes of the predefined ranges: num, hex, a-z, alpha, 0-9 and a-z, alnum, path.
+    const run_generators_t run_generators[] = {
+        { 10, make_run_generators<10>(std::make_index_sequence<max_run_length>{}) },
+        { 16, make_run_generators<16>(std::make_index_sequence<max_run_length>{}) },
+        { 26, make_run_generators<26>(std::make_index_sequence<max_run_length>{}) },
+        { 27, make_run_generators<27>(std::make_index_sequence<max_run_length>{}) },
+        { 36, make_run_generators<36>(std::make_index_sequence<max_run_length>{}) },
+        { 37, make_run_generators<37>(std::make_index_sequence<max_run_length>{}) },
+        { 41, make_run_generators<41>(std::make_index_sequence<max_run_length>{}) },
+    };
+}
+
+pattern_generator find_generator(pattern_program const& program)
+{
+    shape_t shape;
+    if (!match_shape(program, shape))
+        return nullptr;
+
+    pattern_step const& step = *shape.step;
+    if (step.listed())
+        return &generate_alternatives;
+
+    if (step.kind == pattern_step::mangled)
+        return &generate_mangled;
+
+    if (step.kind != pattern_step::varying || step.min_length != step.max_length)
+        return nullptr;
+
+    if (step.min_length == 0 || step.min_length > max_run_length)
+        return nullptr;
+
+    for (run_generators_t const& generators : run_generators)
+        if (generators.radix == step.size)
+            return generators.by_length[step.min_length - 1];
+
+    return nullptr;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "uploaded_string.hpp"
+
+struct pattern_program;
+
+// Writes the count values of program starting at index first to output, in enumeration order,
+// exactly as that many calls to pattern_t::write() would.
+using pattern_generator = void (*)(pattern_program const& program, uint64_t first, uploaded_string* output, size_t count);
+
+// Returns a generator specialized for the shape of program, or nullptr if it has none, in which
+// case values go through the generic odometer. Recognized shapes, each with an optional literal
+// before and after:
+//   a single varying run of a fixed length of up to 8 characters, over an alphabet of 10, 16, 26,
+//   27, 36, 37 or 41 characters (the predefined ranges, a-z and 0-9); length and alphabet size are
+//   template parameters of the generator, so that its loops unroll;
+//   a single alternation or wordlist;
+//   a single mangled wordlist, whose words go through each rule in batches.
+pattern_generator find_generator(pattern_program const& program);
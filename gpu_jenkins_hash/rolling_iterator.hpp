@@ -1,185 +1,108 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
-#include <memory>
 
-template <typename Iterator, typename ValueType = typename Iterator::value_type>
+// Odometer over up to capacity digits of the same radix, the last one being the least significant.
+// Used to enumerate every string of a given length over an alphabet: digit i is the index of
+// character i in the alphabet.
+//
+// Digits are stored inline up to inline_capacity, so that the odometers of most steps are copied
+// along with their pattern without allocating; longer ones are stored on the heap.
 class rolling_iterator
 {
 public:
-    using value_type = std::add_pointer_t<std::add_const_t<ValueType>>;
+    constexpr static const size_t inline_capacity = 16;
 
+    rolling_iterator() = default;
 
-    rolling_iterator(Iterator begin, Iterator end) : begin(begin), end(end)
-    {
+    rolling_iterator(uint32_t radix, size_t length, size_t capacity) : radix(radix), capacity(capacity) {
+        if (capacity > inline_capacity)
+            heap_digits.resize(capacity);
 
+        resize(length);
     }
 
-    rolling_iterator(Iterator begin, Iterator end, std::vector<Iterator>&& iterators) : itrs(std::move(iterators)), end(end), begin(begin) {
-        values.resize(itrs.size() + 1);
-        for (size_t i = 0; i < itrs.size(); ++i)
-            values[i] = *(itrs[i]);
-
-        *values.rbegin() = ValueType{};
-
-        if (itrs.size() > 0) {
-
-            controllers.resize(itrs.size());
-            for (auto&& itr : controllers)
-                itr = false;
-
-            *controllers.rbegin() = true;
-        }
-    }
-
-    explicit rolling_iterator(rolling_iterator const& o) : itrs(o.itrs), end(o.end), begin(o.begin),
-        values(o.values), controllers(o.controllers), done(o.done) {
-
-    }
-
-    explicit rolling_iterator(rolling_iterator&& o) : itrs(std::move(o.itrs)), end(std::move(o.end)), begin(std::move(o.begin)),
-        values(std::move(o.values)), controllers(std::move(o.controllers)), done(o.done) {
-
-    }
-
-    rolling_iterator() {
-        // Should never be called.
+    // Changes the number of digits, which must not exceed the capacity, and resets them to zero.
+    void resize(size_t length) {
+        count = length;
+        reset();
     }
 
-    rolling_iterator& operator = (rolling_iterator const& o) {
-        itrs = o.itrs;
-        begin = o.begin;
-        end = o.end;
-        values = o.values;
-        controllers = o.controllers;
-        done = o.done;
+    void reset() {
+        uint32_t* digits = data();
+        for (size_t i = 0; i < count; ++i)
+            digits[i] = 0;
 
-		return *this;
+        done = false;
+        changed = 0;
     }
 
-    rolling_iterator& operator = (rolling_iterator const&& o) {
-        itrs = std::move(o.itrs);
-        begin = std::move(o.begin);
-        end = std::move(o.end);
-        values = std::move(o.values);
-        controllers = std::move(o.controllers);
-        done = o.done;
+    size_t size() const { return count; }
+    uint32_t get_radix() const { return radix; }
 
-        return *this;
-    }
+    uint32_t operator [] (size_t index) const { return current()[index]; }
+    const uint32_t* current() const { return heap_digits.empty() ? inline_digits.data() : heap_digits.data(); }
 
-    // expands the collection of iterators by the given amount (default 1)
-    // also resets the state.
-    void expand(size_t count = 1) {
-        values.resize(values.size() + count);
-        itrs.resize(itrs.size() + count);
-        controllers.resize(controllers.size() + count);
+    // Moves to the next value. Digits are incremented from the last one, and carrying stops at the
+    // first one that does not wrap around; if all of them do, the odometer is back to zero and
+    // all_done() is set.
+    void move_next() {
+        uint32_t* digits = data();
+        for (size_t i = count; i-- > 0; ) {
+            const uint32_t next = digits[i] + 1;
+            const bool wrapped = next == radix;
 
-        reset();
-    }
+            digits[i] = wrapped ? 0 : next;
+            changed = i;
 
-    void reset() {
-        for (size_t i = 0; i < itrs.size(); ++i) {
-            itrs[i] = begin;
-            values[i] = *begin;
-            controllers[i] = (i + 1) == itrs.size();
+            if (!wrapped)
+                return;
         }
 
-        done = false;
+        done = true;
     }
 
-    void shrink_to(size_t count) {
-        values.resize(count);
-        itrs.resize(count);
-        controllers.resize(count);
+    // Moves n values ahead in one go, by adding n to the digits in base radix; as with move_next(),
+    // going past the last value wraps around and sets all_done().
+    void advance(uint64_t n) {
+        uint32_t* digits = data();
+        for (size_t i = count; i-- > 0 && n != 0; ) {
+            const uint64_t sum = digits[i] + n % radix;
+            const bool carry = sum >= radix;
+
+            digits[i] = uint32_t(carry ? sum - radix : sum);
+            n = n / radix + (carry ? 1 : 0);
+            changed = i;
+        }
 
-        reset();
+        if (n != 0)
+            done = true;
     }
 
-    size_t size() const { return itrs.size(); }
-
-    value_type current() const { return values.data(); }
-
-    void move_next() {
-        // This is (in hindsight) very simple
-        // we iterate every item from the end to the start
-        // when a character is done, it resets, the previous character advances once, and then
-        //  the last character iterates again
-        // when the first character is done, that's our exit condition
-
-		// yoda condition, when i reaches 0 it underflows to size_t::max.
-        for (size_t i = itrs.size() - 1; i < itrs.size(); --i)
-        {
-            Iterator& itr = itrs[i];
-            if (controllers[i])
-                ++itr;
-
-            // if end
-            if (itr == end)
-            {
-                if (i > 0) {
-                    // unlock previous
-                    controllers[i - 1] = true;
-
-                    // lock current
-                    controllers[i] = false;
-
-                    // reset current
-                    itr = begin;
-                }
-            }
-            else
-            {
-                // if not last and not locked
-                if (i + 1 < itrs.size() && controllers[i])
-                {
-                    // lock current
-                    controllers[i] = false;
-                    // unlock last
-                    controllers[itrs.size() - 1] = true;
-                }
-            }
-
-            // if value then set otherwise done
-            if (itr != end)
-                values[i] = *itr;
-            else
-                done = true;
-        }
+    // Resizes to length digits and moves to the index-th value.
+    void seek(size_t length, uint64_t index) {
+        resize(length);
+        advance(index);
+        changed = 0;
     }
 
     bool all_done() const {
         return done;
     }
 
-    std::vector<Iterator> itrs;   // the actual iterators
-    std::vector<ValueType> values;// values for each iterator
-    std::vector<bool> controllers;// controlling booleans, a boolean set to true means the corresponding iterator can advance
-    bool done = false;            // set when the last iterator is done looping (the first one)
-
-    Iterator end;                 // marker value to check that a given iterator is done
-    Iterator begin;               // default value for a given iterator to cycle.
-};
-
-template <typename Iterator, typename ValueType = typename std::add_pointer<typename Iterator::value_type>::type>
-inline bool operator == (rolling_iterator<Iterator, ValueType> const& lhs, rolling_iterator<Iterator, ValueType> const& rhs) {
-    if (lhs.all_done() == rhs.all_done())
-        return true;
-
-    if (lhs.itrs.size() != rhs.itrs.size())
-        return false;
+    size_t changed = 0;           // index of the first digit modified by the last move_next() or advance()
 
-    if (lhs.end != rhs.end)
-        return false;
+private:
+    uint32_t* data() { return heap_digits.empty() ? inline_digits.data() : heap_digits.data(); }
 
-    for (size_t i = 0; i < lhs.itrs.size(); ++i)
-        if (lhs.itrs[i] != rhs.itrs[i])
-            return false;
+    std::array<uint32_t, inline_capacity> inline_digits{};
+    std::vector<uint32_t> heap_digits;
 
-    return true;
-}
-
-template <typename Iterator, typename ValueType = typename std::add_pointer<typename Iterator::value_type>::type>
-inline bool operator != (rolling_iterator<Iterator, ValueType> const& lhs, rolling_iterator<Iterator, ValueType> const& rhs) {
-    return !(lhs == rhs);
-}
+    uint32_t radix = 1;
+    size_t capacity = 0;
+    size_t count = 0;
+    bool done = false;            // set when the first digit wrapped around
+};
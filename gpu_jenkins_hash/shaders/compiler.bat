@@ -1,3 +1,9 @@
 C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V jenkins.comp
+C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V -DFILTER_TARGETS jenkins.comp -o filter.spv
+C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V -DGENERATE_CANDIDATES -DFILTER_TARGETS jenkins.comp -o generate.spv
+C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V -DPACKED_STRINGS jenkins.comp -o packed.spv
+C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V -DPACKED_STRINGS -DFILTER_TARGETS jenkins.comp -o packed_filter.spv
+C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V -DRUN_MIDSTATES jenkins.comp -o runs.spv
+C:\VulkanSDK\1.1.77.0\Bin32\glslangValidator.exe -V -DRUN_MIDSTATES -DFILTER_TARGETS jenkins.comp -o runs_filter.spv
 
 pause
\ No newline at end of file
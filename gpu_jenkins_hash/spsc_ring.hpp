@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// try_push and try_pop never block; push and pop sleep until the other side makes room or hands
+// over a value, or until the ring is closed. Only push and pop wake each other up, so a side that
+// waits must be paired with one that uses them.
+template <typename T>
+class spsc_ring {
+public:
+    explicit spsc_ring(size_t capacity) : _slots(capacity + 1) { }
+
+    spsc_ring(spsc_ring const&) = delete;
+    spsc_ring& operator = (spsc_ring const&) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool try_push(T const& value) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if (next == _head.load(std::memory_order_acquire))
+            return false;
+
+        _slots[tail] = value;
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool try_pop(T& value) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return false;
+
+        value = _slots[head];
+        _head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    // Producer side. Waits for room; returns false, without pushing, if the ring was closed.
+    bool push(T const& value) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_closed) {
+            if (try_push(value)) {
+                _changed.notify_all();
+                return true;
+            }
+
+            _changed.wait(lock);
+        }
+
+        return false;
+    }
+
+    // Consumer side. Waits for a value; returns false if the ring was closed, even if it is not empty.
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_closed) {
+            if (try_pop(value)) {
+                _changed.notify_all();
+                return true;
+            }
+
+            _changed.wait(lock);
+        }
+
+        return false;
+    }
+
+    // Wakes up both sides for good; meant for stopping a pipeline that failed.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+
+        _changed.notify_all();
+    }
+
+private:
+    // One slot is always left empty to tell a full ring from an empty one.
+    std::vector<T> _slots;
+
+    // Written by the consumer and the producer respectively; kept on separate cache lines.
+    alignas(64) std::atomic<size_t> _head{ 0 };
+    alignas(64) std::atomic<size_t> _tail{ 0 };
+
+    // Only taken by push, pop and close, around the checks that decide to sleep, so that no
+    // wake-up is lost in between.
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    bool _closed = false;
+
+    size_t increment(size_t index) const {
+        return index + 1 == _slots.size() ? 0 : index + 1;
+    }
+};
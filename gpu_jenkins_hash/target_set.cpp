@@ -0,0 +1,136 @@
+#include "target_set.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cctype>
+
+void target_set::load(std::string const& path)
+{
+    if (_lists.size() == max_lists)
+        throw std::runtime_error("Too many target lists (at most " + std::to_string(max_lists) + " are supported)");
+
+    std::ifstream fs(path);
+    if (!fs.is_open())
+        throw std::runtime_error("Failed to open target list '" + path + "'");
+
+    const uint32_t list = uint32_t(_lists.size());
+
+    // Name lists after their file, without directories or extension.
+    size_t nameStart = path.find_last_of("/\\");
+    nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+    size_t nameEnd = path.find('.', nameStart);
+    _lists.push_back(path.substr(nameStart, nameEnd == std::string::npos ? std::string::npos : nameEnd - nameStart));
+
+    std::string line;
+    while (std::getline(fs, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+
+        if (line.compare(start, 2, "0x") == 0 || line.compare(start, 2, "0X") == 0)
+            start += 2;
+
+        size_t end = start;
+        uint32_t hash = 0;
+        for (; end < line.size() && std::isxdigit(static_cast<unsigned char>(line[end])); ++end)
+            hash = (hash << 4) | uint32_t(std::isdigit(static_cast<unsigned char>(line[end])) ? line[end] - '0' : (std::toupper(line[end]) - 'A' + 10));
+
+        if (end == start)
+            throw std::runtime_error("Invalid hash '" + line + "' in target list '" + path + "'");
+
+        // Hashes are 32 bits; longer ones were not made by lookup3, and would never match.
+        if (end - start > 8)
+            throw std::runtime_error("Hash '" + line + "' in target list '" + path + "' is longer than 8 hexadecimal digits");
+
+        _pending.emplace_back(hash, list);
+    }
+}
+
+void target_set::build()
+{
+    std::sort(_pending.begin(), _pending.end());
+
+    _hashes.clear();
+    _tags.clear();
+    for (auto const& [hash, list] : _pending) {
+        if (_hashes.empty() || _hashes.back() != hash) {
+            _hashes.push_back(hash);
+            _tags.push_back(0);
+        }
+
+        _tags.back() |= tag_mask(1) << list;
+    }
+
+    _pending.clear();
+    _pending.shrink_to_fit();
+
+    _directory.assign(0x10001, 0);
+    for (uint32_t hash : _hashes)
+        ++_directory[(hash >> 16) + 1];
+    for (size_t i = 1; i < _directory.size(); ++i)
+        _directory[i] += _directory[i - 1];
+
+    // About 8 bits per hash keeps the false positive rate near 12%, and the bitmap small enough
+    // to stay in cache: 4 MiB for 4 million hashes.
+    uint32_t filterBits = 16;
+    while (filterBits < 27 && (size_t(1) << filterBits) < _hashes.size() * 8)
+        ++filterBits;
+
+    _filterShift = 32 - filterBits;
+    _filter.assign((size_t(1) << filterBits) / 64, 0);
+    for (uint32_t hash : _hashes) {
+        uint32_t bit = hash >> _filterShift;
+        _filter[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+}
+
+target_set::tag_mask target_set::find_sorted(uint32_t hash) const
+{
+    auto begin = _hashes.begin() + _directory[hash >> 16];
+    auto end = _hashes.begin() + _directory[(hash >> 16) + 1];
+
+    auto itr = std::lower_bound(begin, end, hash);
+    if (itr == end || *itr != hash)
+        return 0;
+
+    return _tags[size_t(itr - _hashes.begin())];
+}
+
+std::vector<uint32_t> target_set::pack() const
+{
+    const size_t filterWords = _filter.size() * 2;
+
+    std::vector<uint32_t> packed;
+    packed.reserve(4 + filterWords + _directory.size() + _hashes.size());
+
+    packed.push_back(_filterShift);
+    packed.push_back(uint32_t(filterWords));
+    packed.push_back(uint32_t(_hashes.size()));
+    packed.push_back(0);
+
+    // Bit n of the filter lives in bit (n % 32) of word (n / 32) once split into 32-bit words.
+    for (uint64_t word : _filter) {
+        packed.push_back(uint32_t(word));
+        packed.push_back(uint32_t(word >> 32));
+    }
+
+    packed.insert(packed.end(), _directory.begin(), _directory.end());
+    packed.insert(packed.end(), _hashes.begin(), _hashes.end());
+    return packed;
+}
+
+std::string target_set::list_names(tag_mask mask) const
+{
+    std::string names;
+    for (size_t i = 0; i < _lists.size(); ++i) {
+        if ((mask & (tag_mask(1) << i)) == 0)
+            continue;
+
+        if (!names.empty())
+            names += ", ";
+        names += _lists[i];
+    }
+
+    return names;
+}
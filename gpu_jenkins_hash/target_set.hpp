@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Hashes we are trying to resolve, possibly coming from several lists (one per product, say).
+// Every hash carries a mask of the lists it was found in.
+//
+// Lookups go through a bitmap indexed by the top bits of the hash first; since target hashes are
+// sparse and uniformly distributed, nearly every candidate is rejected by a single bit test. Hits
+// are confirmed by a binary search in the bucket of sorted hashes sharing their top 16 bits.
+class target_set {
+public:
+    using tag_mask = uint32_t;
+
+    constexpr static const size_t max_lists = sizeof(tag_mask) * 8;
+
+    // Loads a list of hashes, one per line, written in hexadecimal with an optional 0x prefix.
+    // Anything following the hash on a line is ignored, as are empty lines and lines starting with #.
+    // Hashes longer than 8 digits are rejected.
+    void load(std::string const& path);
+
+    // Builds the lookup structures. Must be called once every list is loaded.
+    void build();
+
+    bool empty() const { return _hashes.empty(); }
+    size_t size() const { return _hashes.size(); }
+
+    size_t list_count() const { return _lists.size(); }
+    std::string const& list_name(size_t index) const { return _lists[index]; }
+
+    // Names of the lists in mask, separated by commas.
+    std::string list_names(tag_mask mask) const;
+
+    // Returns the mask of the lists that contain hash, or 0 if none does.
+    tag_mask find(uint32_t hash) const {
+        uint32_t bit = hash >> _filterShift;
+        if ((_filter[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0)
+            return 0;
+
+        return find_sorted(hash);
+    }
+
+    // Flattened copy of the lookup structures, as read by the filtering compute shader:
+    // filter shift, filter size in words, hash count, a reserved word, then the filter, the
+    // directory and the sorted hashes. List tags are left out; hits are tagged on the host.
+    std::vector<uint32_t> pack() const;
+
+private:
+    tag_mask find_sorted(uint32_t hash) const;
+
+    std::vector<std::string> _lists;
+
+    // (hash, list index) pairs, until build() runs.
+    std::vector<std::pair<uint32_t, uint32_t>> _pending;
+
+    // Sorted, unique hashes and the lists each of them belongs to.
+    std::vector<uint32_t> _hashes;
+    std::vector<tag_mask> _tags;
+
+    // _hashes[_directory[i] .. _directory[i + 1]) share i as their top 16 bits.
+    std::vector<uint32_t> _directory;
+
+    std::vector<uint64_t> _filter = std::vector<uint64_t>(1, 0);
+    uint32_t _filterShift = 31;
+};
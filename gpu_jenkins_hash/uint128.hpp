@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <algorithm>
+
+// Unsigned 128-bit integer, for counting the values of patterns that do not fit in 64 bits.
+// MSVC has no native 128-bit type; only what keyspace arithmetic needs is provided, and every
+// operation that could wrap around reports it instead.
+struct uint128 {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    uint128() = default;
+    uint128(uint64_t value) : low(value) { }
+    uint128(uint64_t high, uint64_t low) : high(high), low(low) { }
+
+    bool fits_64() const { return high == 0; }
+
+    explicit operator double() const {
+        return double(high) * 18446744073709551616.0 + double(low);
+    }
+
+    bool operator == (uint128 const& other) const { return high == other.high && low == other.low; }
+    bool operator != (uint128 const& other) const { return !(*this == other); }
+    bool operator < (uint128 const& other) const {
+        return high != other.high ? high < other.high : low < other.low;
+    }
+
+    // Stores lhs + rhs in result; returns false if it does not fit.
+    static bool add(uint128 const& lhs, uint128 const& rhs, uint128& result) {
+        uint64_t low = lhs.low + rhs.low;
+        uint64_t carry = low < lhs.low ? 1 : 0;
+
+        uint64_t high = lhs.high + rhs.high;
+        if (high < lhs.high || high + carry < high)
+            return false;
+
+        result = uint128(high + carry, low);
+        return true;
+    }
+
+    // Stores lhs * rhs in result; returns false if it does not fit.
+    static bool multiply(uint128 const& lhs, uint128 const& rhs, uint128& result) {
+        if (lhs.high != 0 && rhs.high != 0)
+            return false;
+
+        uint128 product = multiply(lhs.low, rhs.low);
+
+        // At most one of the cross products is not zero.
+        uint128 cross = multiply(lhs.high, rhs.low);
+        uint128 other = multiply(lhs.low, rhs.high);
+        if (!cross.fits_64() || !other.fits_64())
+            return false;
+
+        uint64_t high = product.high + (cross.low + other.low);
+        if (high < product.high)
+            return false;
+
+        result = uint128(high, product.low);
+        return true;
+    }
+
+    // Full product of two 64-bit values, out of 32-bit halves.
+    static uint128 multiply(uint64_t lhs, uint64_t rhs) {
+        const uint64_t lhs_low = uint32_t(lhs), lhs_high = lhs >> 32;
+        const uint64_t rhs_low = uint32_t(rhs), rhs_high = rhs >> 32;
+
+        const uint64_t low_low = lhs_low * rhs_low;
+        const uint64_t high_low = lhs_high * rhs_low;
+        const uint64_t low_high = lhs_low * rhs_high;
+        const uint64_t high_high = lhs_high * rhs_high;
+
+        // Cannot overflow: at most (2^32 - 1) * 2 + (2^32 - 1)^2.
+        const uint64_t middle = (low_low >> 32) + uint32_t(high_low) + low_high;
+
+        return uint128(high_high + (high_low >> 32) + (middle >> 32), (middle << 32) | uint32_t(low_low));
+    }
+
+    std::string to_string() const {
+        if (high == 0)
+            return std::to_string(low);
+
+        // Long division by 10, 32 bits at a time.
+        uint32_t limbs[4] = { uint32_t(high >> 32), uint32_t(high), uint32_t(low >> 32), uint32_t(low) };
+
+        std::string digits;
+        while (limbs[0] != 0 || limbs[1] != 0 || limbs[2] != 0 || limbs[3] != 0) {
+            uint64_t remainder = 0;
+            for (uint32_t& limb : limbs) {
+                uint64_t value = (remainder << 32) | limb;
+                limb = uint32_t(value / 10);
+                remainder = value % 10;
+            }
+
+            digits += char('0' + remainder);
+        }
+
+        std::reverse(digits.begin(), digits.end());
+        return digits;
+    }
+};
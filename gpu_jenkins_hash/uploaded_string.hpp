@@ -23,6 +23,9 @@ private:
     uint32_t words[32 * 3];
 
 public:
+    // Maximum number of characters a string can hold.
+    constexpr static const size_t max_length = sizeof(uint32_t) * 32 * 3;
+
     uint32_t get_hash() const {
         return hash;
     }
@@ -31,6 +34,10 @@ public:
         return hashlittle((const void*)words, char_count, 0);
     }
 
+    void set_hash(uint32_t value) {
+        hash = value;
+    }
+
     std::string_view value() const {
         return std::string_view(reinterpret_cast<const char*>(words), static_cast<size_t>(char_count)); //-V206
     }
@@ -55,6 +62,18 @@ public:
         char_count = 0;
     }
 
+    // Replaces the value. Every byte past the current value must be zero, as it is for any string
+    // built by this class; only the bytes of the old value past the end of the new one are cleared.
+    void assign(std::string_view const& sv) {
+        char* bytes = reinterpret_cast<char*>(words);
+
+        memcpy(bytes, sv.data(), sv.size());
+        if (size_t(char_count) > sv.size())
+            memset(bytes + sv.size(), 0, size_t(char_count) - sv.size());
+
+        char_count = int32_t(sv.size());
+    }
+
     void append(std::string_view const& sv) {
         memcpy(reinterpret_cast<char*>(words) + char_count, sv.data(), sv.size());
         char_count += int32_t(sv.size());
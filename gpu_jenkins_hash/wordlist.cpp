@@ -0,0 +1,286 @@
+#include "wordlist.hpp"
+#include "uploaded_string.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace {
+    // Text lines never hold a NUL, so no text wordlist starts with this.
+    constexpr const char binary_magic[8] = { 'W', 'O', 'R', 'D', 'L', 'S', 'T', '\0' };
+    constexpr const uint32_t binary_version = 1;
+
+    struct binary_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t length_count;
+        uint64_t word_count;
+    };
+
+    struct binary_length {
+        uint32_t length;
+        uint32_t reserved;
+        uint64_t count;
+        uint64_t offset;
+    };
+
+    static_assert(sizeof(binary_header) == 24 && sizeof(binary_length) == 24, "Binary wordlists have no padding");
+
+    uint32_t padded(size_t length) {
+        return uint32_t((length + 3) & ~size_t(3));
+    }
+}
+
+std::shared_ptr<const wordlist> wordlist::open(std::string const& path)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const wordlist>> mapped;
+
+    std::error_code error;
+    std::string key = std::filesystem::weakly_canonical(path, error).string();
+    if (error)
+        key = path;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<const wordlist> words = mapped[key].lock();
+    if (!words) {
+        words = std::shared_ptr<const wordlist>(new wordlist(path));
+        mapped[key] = words;
+    }
+
+    return words;
+}
+
+wordlist::wordlist(std::string path) : _path(std::move(path))
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open wordlist '" + _path + "'");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to open wordlist '" + _path + "'");
+    }
+
+    _size = size_t(size.QuadPart);
+    if (_size != 0) {
+        _mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (_mapping != nullptr)
+            _data = static_cast<char*>(MapViewOfFile(_mapping, FILE_MAP_COPY, 0, 0, 0));
+    }
+    CloseHandle(file);
+
+    if (_size != 0 && _data == nullptr) {
+        if (_mapping != nullptr)
+            CloseHandle(_mapping);
+        throw std::runtime_error("Failed to map wordlist '" + _path + "'");
+    }
+#else
+    int file = ::open(_path.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("Failed to open wordlist '" + _path + "'");
+
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        ::close(file);
+        throw std::runtime_error("Failed to open wordlist '" + _path + "'");
+    }
+
+    _size = size_t(status.st_size);
+    if (_size != 0) {
+        void* data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        _data = data == MAP_FAILED ? nullptr : static_cast<char*>(data);
+    }
+    ::close(file);
+
+    if (_size != 0 && _data == nullptr)
+        throw std::runtime_error("Failed to map wordlist '" + _path + "'");
+#endif
+
+    if (load_binary())
+        return;
+
+    size_t skipped = 0;
+    for (size_t offset = 0; offset < _size; ) {
+        const char* end = static_cast<const char*>(memchr(_data + offset, '\n', _size - offset));
+        size_t next = end == nullptr ? _size : size_t(end - _data) + 1;
+
+        size_t length = (end == nullptr ? _size : size_t(end - _data)) - offset;
+        if (length != 0 && _data[offset + length - 1] == '\r')
+            --length;
+
+        if (length > uploaded_string::max_length)
+            ++skipped;
+        else if (length != 0) {
+            // Only written to if it changes, so that pages already normalized stay shared with the file.
+            char* word = _data + offset;
+            for (size_t i = 0; i < length; ++i) {
+                char c = word[i] == '/' ? '\\' : char(std::toupper(static_cast<unsigned char>(word[i])));
+                if (c != word[i])
+                    word[i] = c;
+            }
+
+            _shortest = _words.empty() ? length : std::min(_shortest, length);
+            _longest = std::max(_longest, length);
+            _words.emplace_back(word, length);
+        }
+
+        offset = next;
+    }
+
+    _count = _words.size();
+
+    if (skipped != 0)
+        std::cerr << ">> Skipped " << skipped << " lines of wordlist '" << _path << "' longer than " << uploaded_string::max_length << " characters.\n";
+}
+
+bool wordlist::load_binary()
+{
+    binary_header header;
+    if (_size < sizeof(header))
+        return false;
+
+    memcpy(&header, _data, sizeof(header));
+    if (memcmp(header.magic, binary_magic, sizeof(binary_magic)) != 0)
+        return false;
+
+    if (header.version != binary_version)
+        throw std::runtime_error("Wordlist '" + _path + "' has unsupported version " + std::to_string(header.version));
+
+    if (header.length_count > uploaded_string::max_length || sizeof(header) + header.length_count * sizeof(binary_length) > _size)
+        throw std::runtime_error("Wordlist '" + _path + "' is corrupt");
+
+    // Sections follow the table and each other, and end with the file.
+    uint64_t first = 0;
+    uint64_t offset = sizeof(header) + uint64_t(header.length_count) * sizeof(binary_length);
+    for (uint32_t i = 0; i < header.length_count; ++i) {
+        binary_length entry;
+        memcpy(&entry, _data + sizeof(header) + i * sizeof(binary_length), sizeof(entry));
+
+        const uint32_t stride = padded(entry.length);
+        if (entry.length == 0 || entry.length > uploaded_string::max_length || entry.count == 0
+            || entry.offset != offset || entry.count > (_size - entry.offset) / stride
+            || (!_lengths.empty() && entry.length <= _lengths.back().length))
+            throw std::runtime_error("Wordlist '" + _path + "' is corrupt");
+
+        _lengths.push_back(length_t{ first, entry.length, stride, _data + entry.offset });
+        first += entry.count;
+        offset += entry.count * stride;
+    }
+
+    if (first != header.word_count || offset != _size)
+        throw std::runtime_error("Wordlist '" + _path + "' is corrupt");
+
+    _count = size_t(first);
+    _shortest = _lengths.empty() ? 0 : _lengths.front().length;
+    _longest = _lengths.empty() ? 0 : _lengths.back().length;
+    return true;
+}
+
+void wordlist::convert(std::string const& from, std::string const& to)
+{
+    std::error_code error;
+    if (std::filesystem::equivalent(from, to, error))
+        throw std::runtime_error("Cannot convert wordlist '" + from + "' onto itself");
+
+    std::shared_ptr<const wordlist> words = open(from);
+
+    // Number of words of every length.
+    std::vector<uint64_t> counts(words->longest() + 1, 0);
+    for (size_t i = 0; i < words->size(); ++i)
+        ++counts[(*words)[i].size()];
+
+    std::vector<binary_length> lengths;
+    for (size_t length = 1; length < counts.size(); ++length)
+        if (counts[length] != 0)
+            lengths.push_back(binary_length{ uint32_t(length), 0, counts[length], 0 });
+
+    uint64_t offset = sizeof(binary_header) + lengths.size() * sizeof(binary_length);
+    std::vector<uint64_t> next(counts.size(), 0);
+    for (binary_length& entry : lengths) {
+        entry.offset = offset;
+        next[entry.length] = offset;
+        offset += entry.count * padded(entry.length);
+    }
+
+    std::ofstream fs(to, std::ios::binary | std::ios::trunc);
+    if (!fs.is_open())
+        throw std::runtime_error("Failed to write wordlist '" + to + "'");
+
+    binary_header header;
+    memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.version = binary_version;
+    header.length_count = uint32_t(lengths.size());
+    header.word_count = words->size();
+
+    fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fs.write(reinterpret_cast<const char*>(lengths.data()), std::streamsize(lengths.size() * sizeof(binary_length)));
+
+    // Words are scattered to the section of their length in a single pass, through one buffer per
+    // length, so that memory use stays bounded whatever the size of the list.
+    constexpr const size_t flush_size = 1 << 16;
+    std::vector<std::string> buffers(counts.size());
+    auto flush = [&fs, &next, &buffers](size_t length) {
+        std::string& buffer = buffers[length];
+
+        fs.seekp(std::streamoff(next[length]));
+        fs.write(buffer.data(), std::streamsize(buffer.size()));
+
+        next[length] += buffer.size();
+        buffer.clear();
+    };
+
+    const char zeros[4] = {};
+    for (size_t i = 0; i < words->size(); ++i) {
+        std::string_view word = (*words)[i];
+
+        std::string& buffer = buffers[word.size()];
+        buffer.append(word.data(), word.size());
+        buffer.append(zeros, padded(word.size()) - word.size());
+
+        if (buffer.size() >= flush_size)
+            flush(word.size());
+    }
+
+    for (size_t length = 1; length < buffers.size(); ++length)
+        if (!buffers[length].empty())
+            flush(length);
+
+    fs.flush();
+    if (!fs)
+        throw std::runtime_error("Failed to write wordlist '" + to + "'");
+
+    std::cout << ">> Wrote " << words->size() << " words of " << lengths.size() << " lengths to '" << to << "'.\n";
+}
+
+wordlist::~wordlist()
+{
+#ifdef _WIN32
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+#else
+    if (_data != nullptr)
+        munmap(_data, _size);
+#endif
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A file of words, one per line, mapped in memory for {file.txt} pattern nodes. Lines are indexed
+// once when the file is opened, and words are string_views into the mapping, so enumerating them
+// copies nothing.
+//
+// Words are normalized like literals (uppercase, slashes as backslashes), in place: the file is
+// mapped copy-on-write, so only the pages that hold words needing it are copied, and the file
+// itself is never modified. Unlike literals, words are taken as is otherwise; backslashes are not
+// escapes. Empty lines, and lines longer than uploaded_string::max_length characters, are skipped.
+//
+// Files written by convert() are recognized by their header and need none of that: their words
+// are already normalized, and grouped by length, so finding a word takes a lookup in a table of
+// at most one entry per length instead of an index of every line. Opening one costs the same
+// whatever its size. The binary format, all integers little-endian:
+//   header     "WORDLST\0", uint32 version (1), uint32 number of lengths, uint64 number of words
+//   lengths    for each length, shortest first: uint32 length, uint32 zero, uint64 number of words,
+//              uint64 offset of the first word from the start of the file
+//   words      every word of every length, each padded with zeros to a multiple of 4 bytes, so
+//              that every word starts on a 4-byte boundary and ends in zeros like uploaded_string
+class wordlist {
+public:
+    // Returns the wordlist of the file at path, mapping it unless it is still mapped for another
+    // pattern; every copy of a pattern shares the same mapping.
+    static std::shared_ptr<const wordlist> open(std::string const& path);
+
+    ~wordlist();
+
+    wordlist(wordlist const&) = delete;
+    wordlist& operator = (wordlist const&) = delete;
+
+    // Writes the words of the wordlist at from (of either format) to to, in the binary format;
+    // words keep their order within each length.
+    static void convert(std::string const& from, std::string const& to);
+
+    std::string const& path() const { return _path; }
+
+    size_t size() const { return _count; }
+
+    std::string_view operator [] (size_t index) const {
+        if (_lengths.empty())
+            return _words[index];
+
+        // Last length whose first word is not past index.
+        auto length = std::upper_bound(_lengths.begin(), _lengths.end(), index, [](size_t index, length_t const& length) {
+            return index < length.first;
+        }) - 1;
+
+        return std::string_view(length->data + (index - length->first) * length->stride, length->length);
+    }
+
+    // Lengths of its shortest and longest words.
+    size_t shortest() const { return _shortest; }
+    size_t longest() const { return _longest; }
+
+private:
+    explicit wordlist(std::string path);
+
+    // Indexes a file in the binary format; returns false if it is not one.
+    bool load_binary();
+
+    // Words of a given length in a binary wordlist.
+    struct length_t {
+        uint64_t first;         // index of the first of them
+        uint32_t length;
+        uint32_t stride;        // length, padded to a multiple of 4
+        const char* data;
+    };
+
+    std::string _path;
+
+    char* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _mapping = nullptr;
+#endif
+
+    // Text files only.
+    std::vector<std::string_view> _words;
+
+    // Binary files only.
+    std::vector<length_t> _lengths;
+
+    size_t _count = 0;
+    size_t _shortest = 0;
+    size_t _longest = 0;
+};
@@ -0,0 +1,93 @@
+#include "test.hpp"
+
+#include "pattern.hpp"
+#include "pattern_dedup.hpp"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+    struct dedup_case {
+        std::vector<std::string> patterns;
+        size_t skipped;
+        size_t rewritten;
+    };
+
+    // Number of times each value comes out of the patterns; lines that do not compile produce none.
+    std::map<std::string, size_t> values_of(std::vector<std::string> const& patterns) {
+        std::map<std::string, size_t> values;
+        for (std::string const& text : patterns) {
+            pattern_t pattern;
+            try {
+                pattern.load(text);
+            }
+            catch (const std::exception&) {
+                continue;
+            }
+
+            uploaded_string value;
+            while (pattern.write(value))
+                ++values[std::string(value.value())];
+        }
+
+        return values;
+    }
+
+    size_t total(std::map<std::string, size_t> const& values) {
+        size_t count = 0;
+        for (auto const& value : values)
+            count += value.second;
+
+        return count;
+    }
+}
+
+TEST(dedup_keeps_every_value_exactly_once) {
+    const std::vector<dedup_case> cases = {
+        // Narrower line after a wider one, and the other way around.
+        { { "A_[a-z]{1,3}", "A_[a-z]{2}" }, 1, 0 },
+        { { "A_[a-z]{2}", "A_[a-z]{1,3}" }, 0, 1 },
+        // Ranges whose lengths overlap.
+        { { "X[a-z]{1,2}Y", "X[a-z]{2,3}Y", "X[a-z]{0,4}Y" }, 0, 2 },
+        // Alternations sharing values, spelled differently.
+        { { "foo/(a|b|c).txt", "FOO/(b|d|a|d).TXT", "foo/b.txt" }, 1, 1 },
+        { { "DIR/(x|y)[num]{1}", "DIR/(x|y)[hex]{1}", "DIR/(y|x)[0-9]{1}" }, 2, 0 },
+        { { "P[path]{1}", "P[a-z|_-_]{1,2}", "P(\\(|Q)" }, 0, 2 },
+        // Lines that do not compile are passed through.
+        { { "[num]{2}(A|B)", "[0-9]{2}(A|C)", "[num]{2}A", "broken[a-z" }, 1, 1 },
+        // Repeats within an alternation.
+        { { "a(x|x|y)b" }, 0, 1 },
+        // Overlaps dedup does not look for are left alone.
+        { { "Q[path]{0,1}", "Q[path|#-#]{1,2}/x" }, 0, 0 },
+        { { "Q[path|#-#]{1,2}/x", "Q[path]{1}/x" }, 1, 0 },
+    };
+
+    for (dedup_case const& c : cases) {
+        dedup_stats stats;
+        std::vector<std::string> lines = deduplicate_patterns(c.patterns, stats);
+
+        std::map<std::string, size_t> before = values_of(c.patterns);
+        std::map<std::string, size_t> after = values_of(lines);
+
+        CHECK(stats.skipped == c.skipped);
+        CHECK(stats.rewritten == c.rewritten);
+        CHECK(stats.values_before == double(total(before)));
+        CHECK(stats.values_after == double(total(after)));
+
+        // The same values, none of them twice.
+        CHECK(after.size() == before.size());
+        CHECK(std::equal(before.begin(), before.end(), after.begin(), after.end(), [](auto const& lhs, auto const& rhs) {
+            return lhs.first == rhs.first;
+        }));
+        CHECK(std::all_of(after.begin(), after.end(), [](auto const& value) { return value.second == 1; }));
+    }
+}
+
+TEST(dedup_keeps_lines_in_order) {
+    dedup_stats stats;
+    std::vector<std::string> lines = deduplicate_patterns({ "A_[a-z]{1,3}", "broken[a-z", "A_[a-z]{2}", "B" }, stats);
+
+    CHECK((lines == std::vector<std::string>{ "A_[a-z]{1,3}", "broken[a-z", "B" }));
+}
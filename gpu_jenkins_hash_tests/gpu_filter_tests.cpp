@@ -0,0 +1,199 @@
+#include "test.hpp"
+#include "reference.hpp"
+
+#include "gpu_jenkins_hash.hpp"
+#include "pattern.hpp"
+#include "target_set.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Device filtering runs on the first Vulkan device with a compute queue, and is skipped if there is
+// none. Point VK_ICD_FILENAMES at lavapipe's ICD (lvp_icd.x86_64.json) to run it on the CPU, on
+// machines without a GPU. Shaders are loaded from shaders/, so the working directory must be
+// gpu_jenkins_hash, as the project sets it for the debugger.
+namespace {
+    using match_t = std::pair<std::string, uint32_t>;
+
+    struct filter_fixture {
+        std::vector<std::string> values;
+        target_set targets;
+
+        // Values whose hash is one of the targets, sorted.
+        std::vector<match_t> expected;
+    };
+
+    // Candidates of a few patterns, 1 to 89 characters long; every stride-th of
+    // them is a target, along with hashes that are probably none of them.
+    std::unique_ptr<filter_fixture> make_fixture(size_t stride) {
+        auto fixture = std::make_unique<filter_fixture>();
+
+        for (const char* text : { "interface/icons/inv_misc_(a|bb|ccc)/[a-z]{2}.blp", "[num]{1,3}",
+                                  "world/maps/azeroth/azeroth_[num]{2}_[num]{2}(.adt|_obj0.adt|_tex0.adt)",
+                                  "sound/music/zonemusic/(a|bb)/a_really_long_directory_name_to_go_past_eighty_characters/[hex]{2}.mp3" }) {
+            pattern_t pattern(text);
+
+            uploaded_string value;
+            while (pattern.write(value))
+                fixture->values.emplace_back(value.value());
+        }
+
+        const std::string path = test::temporary_path("targets.txt");
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << std::hex << std::setfill('0');
+
+            for (size_t i = 0; i < fixture->values.size(); i += stride)
+                file << std::setw(8) << reference::hash(fixture->values[i]) << "\n";
+
+            for (uint32_t i = 0; i < 1000; ++i)
+                file << std::setw(8) << i * 2654435761u << "\n";
+        }
+
+        fixture->targets.load(path);
+        fixture->targets.build();
+        std::remove(path.c_str());
+
+        for (std::string const& value : fixture->values) {
+            uint32_t hash = reference::hash(value);
+            if (fixture->targets.find(hash) != 0)
+                fixture->expected.emplace_back(value, hash);
+        }
+
+        std::sort(fixture->expected.begin(), fixture->expected.end());
+        return fixture;
+    }
+
+    // Engine on the first Vulkan device, or null if there is none.
+    std::unique_ptr<JenkinsGpuHash> open_device(size_t workgroupCount) {
+        std::unique_ptr<JenkinsGpuHash> gpu;
+        try {
+            gpu = std::make_unique<JenkinsGpuHash>(3);
+        }
+        catch (const std::runtime_error& e) {
+            std::cout << "    skipped, no usable Vulkan device: " << e.what() << std::endl;
+            return nullptr;
+        }
+
+        gpu->setWorkgroupSize(64, 1, 1);
+        gpu->setWorkgroupCount(uint32_t(workgroupCount), 1, 1);
+        return gpu;
+    }
+
+    // Runs the values of fixture through the device filter, as uploaded_string records or packed
+    // batches, and checks that exactly the expected matches come back.
+    void check_filter(filter_fixture const& fixture, size_t workgroupCount, bool packed) {
+        std::unique_ptr<JenkinsGpuHash> gpu = open_device(workgroupCount);
+        if (!gpu)
+            return;
+
+        gpu->setTargets(&fixture.targets);
+
+        size_t next = 0;
+        std::vector<match_t> matches;
+
+        gpu->setDataProvider([&fixture, &next](uploaded_string* data, size_t capacity) -> size_t {
+            size_t count = std::min(capacity, fixture.values.size() - next);
+            for (size_t i = 0; i < count; ++i)
+                data[i] = fixture.values[next + i];
+
+            memset(data + count, 0, sizeof(uploaded_string) * (capacity - count));
+            next += count;
+            return count;
+        });
+
+        gpu->setOutputHandler([&matches](uploaded_string* data, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                matches.emplace_back(std::string(data[i].value()), data[i].get_hash());
+        });
+
+        if (packed) {
+            gpu->setPackedDataProvider([&fixture, &next](packed_strings& batch) -> size_t {
+                while (next < fixture.values.size() && batch.push_back(fixture.values[next]))
+                    ++next;
+
+                return batch.size();
+            });
+
+            gpu->setPackedOutputHandler([&matches](packed_strings const& batch) {
+                for (size_t i = 0; i < batch.size(); ++i)
+                    matches.emplace_back(std::string(batch.value(i)), batch.hash(i));
+            });
+        }
+
+        gpu->run();
+        gpu->cleanup();
+
+        std::sort(matches.begin(), matches.end());
+        CHECK(next == fixture.values.size());
+        CHECK(matches == fixture.expected);
+    }
+}
+
+TEST(gpu_filter_reads_back_every_match) {
+    std::unique_ptr<filter_fixture> fixture = make_fixture(97);
+
+    check_filter(*fixture, 16, false);
+    check_filter(*fixture, 16, true);
+}
+
+TEST(gpu_filter_keeps_matches_past_the_hit_buffer) {
+    // Every value is a target, and frames hold more of them than the 4096 hits the device
+    // buffer has room for; the host then matches the frame again.
+    std::unique_ptr<filter_fixture> fixture = make_fixture(1);
+    CHECK(fixture->expected.size() > 2 * 80 * 64);
+
+    check_filter(*fixture, 80, false);
+    check_filter(*fixture, 80, true);
+}
+
+TEST(gpu_run_rethrows_handler_errors) {
+    // The output handler fails on the first frame it sees; both frame loops must report it
+    // instead of finishing the run.
+    std::unique_ptr<filter_fixture> fixture = make_fixture(1);
+
+    for (bool pipelined : { false, true }) {
+        std::unique_ptr<JenkinsGpuHash> gpu = open_device(16);
+        if (!gpu)
+            return;
+
+        gpu->setTargets(&fixture->targets);
+        gpu->setPipelined(pipelined);
+
+        size_t next = 0;
+        gpu->setDataProvider([&fixture, &next](uploaded_string* data, size_t capacity) -> size_t {
+            size_t count = std::min(capacity, fixture->values.size() - next);
+            for (size_t i = 0; i < count; ++i)
+                data[i] = fixture->values[next + i];
+
+            memset(data + count, 0, sizeof(uploaded_string) * (capacity - count));
+            next += count;
+            return count;
+        });
+
+        gpu->setOutputHandler([](uploaded_string*, size_t) {
+            throw std::runtime_error("output handler failed");
+        });
+
+        bool thrown = false;
+        try {
+            gpu->run();
+        }
+        catch (const std::runtime_error& e) {
+            thrown = std::string(e.what()) == "output handler failed";
+        }
+
+        gpu->cleanup();
+        CHECK(thrown);
+    }
+}
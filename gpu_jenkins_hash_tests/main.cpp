@@ -0,0 +1,64 @@
+#include "test.hpp"
+
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+namespace {
+    size_t failures = 0;
+}
+
+namespace test {
+    std::vector<test_case>& registry() {
+        static std::vector<test_case> tests;
+        return tests;
+    }
+
+    bool check(bool condition, const char* expression, const char* file, int line) {
+        if (!condition) {
+            std::cerr << file << "(" << line << "): CHECK(" << expression << ") failed" << std::endl;
+            ++failures;
+        }
+
+        return condition;
+    }
+
+    std::string temporary_path(std::string const& name) {
+        return (std::filesystem::temp_directory_path() / ("gpu_jenkins_hash_tests_" + name)).string();
+    }
+}
+
+// Runs every test, or only those whose name contains one of the arguments; returns the number of
+// tests that failed.
+int main(int argc, char* argv[]) {
+    int failed = 0;
+    size_t ran = 0;
+
+    for (test::test_case const& test : test::registry()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected |= std::string_view(test.name).find(argv[i]) != std::string_view::npos;
+
+        if (!selected)
+            continue;
+
+        size_t before = failures;
+        try {
+            test.run();
+        }
+        catch (const std::exception& e) {
+            std::cerr << test.name << ": " << e.what() << std::endl;
+            ++failures;
+        }
+
+        ++ran;
+        if (failures != before)
+            ++failed;
+
+        std::cout << (failures == before ? "[  OK  ] " : "[FAILED] ") << test.name << std::endl;
+    }
+
+    std::cout << ran - failed << " of " << ran << " tests passed" << std::endl;
+    return failed;
+}
@@ -0,0 +1,207 @@
+#include "test.hpp"
+#include "reference.hpp"
+
+#include "pattern.hpp"
+#include "lookup3_incremental.hpp"
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    struct pattern_case {
+        std::string pattern;
+
+        // Values of each node; see reference::expand().
+        std::vector<std::vector<std::string>> nodes;
+    };
+
+    const std::string hex = "0123456789ABCDEF";
+
+    // A wordlist for the dictionary cases, written once per run.
+    std::string const& words_path() {
+        static const std::string path = [] {
+            std::string path = test::temporary_path("pattern_words.txt");
+            std::ofstream(path, std::ios::binary | std::ios::trunc) << "foo\nbar/x\nq\n";
+            return path;
+        }();
+
+        return path;
+    }
+
+    std::vector<pattern_case> const& cases() {
+        static const std::vector<pattern_case> patterns = {
+            { "ab[a-c]{0,2}", { { "AB" }, reference::range("ABC", 0, 2) } },
+            { "[a-c]{0,2}", { reference::range("ABC", 0, 2) } },
+            { "a/b(c|d)", { { "A\\B" }, { "C", "D" } } },
+            { "(x|yy)[num]{1}z", { { "X", "YY" }, reference::range("0123456789", 1, 1), { "Z" } } },
+            { "[num]{2}(x|y)[a-b]{1,3}end", { reference::range("0123456789", 2, 2), { "X", "Y" }, reference::range("AB", 1, 3), { "END" } } },
+            { "interface/icons/(a|bb)[hex]{1,2}(.blp|.tga)", { { "INTERFACE\\ICONS\\" }, { "A", "BB" }, reference::range(hex, 1, 2), { ".BLP", ".TGA" } } },
+            { "world/maps/azeroth/azeroth_[num]{2}_[num]{2}.adt", { { "WORLD\\MAPS\\AZEROTH\\AZEROTH_" }, reference::range("0123456789", 2, 2), { "_" }, reference::range("0123456789", 2, 2), { ".ADT" } } },
+            // A brace right after a node opens a wordlist unless a digit follows it.
+            { "[a-c]{" + words_path() + "}", { reference::range("ABC", 1, 1), { "FOO", "BAR\\X", "Q" } } },
+            { "(a|b){" + words_path() + "}.blp", { { "A", "B" }, { "FOO", "BAR\\X", "Q" }, { ".BLP" } } },
+        };
+
+        return patterns;
+    }
+
+    bool equals(uploaded_string const& value, std::string const& expected) {
+        return value.value() == expected && value.get_cpu_hash() == reference::hash(expected);
+    }
+}
+
+TEST(pattern_enumerates_every_value_in_order) {
+    for (pattern_case const& c : cases()) {
+        std::vector<std::string> expected = reference::expand(c.nodes);
+
+        pattern_t pattern(c.pattern);
+        CHECK(pattern.count() == expected.size());
+
+        std::vector<std::string> values;
+        uploaded_string value;
+        while (pattern.has_next()) {
+            uint64_t index = pattern.next_index();
+            CHECK(index == values.size());
+
+            // The head of a value's run is a prefix of it.
+            std::string head(pattern.head());
+            CHECK(pattern.run_remaining() > 0);
+
+            CHECK(pattern.write(value));
+            CHECK(value.value().substr(0, head.size()) == head);
+            CHECK(equals(value, expected[values.size()]));
+
+            values.emplace_back(value.value());
+        }
+
+        CHECK(values == expected);
+        CHECK(!pattern.write(value));
+    }
+}
+
+TEST(pattern_batch_write_matches_write) {
+    for (pattern_case const& c : cases()) {
+        std::vector<std::string> expected = reference::expand(c.nodes);
+
+        // Frames smaller than the pattern, and not dividing its count.
+        pattern_t pattern(c.pattern);
+        std::vector<uploaded_string> frame(7);
+
+        size_t written = 0;
+        while (size_t count = pattern.write(frame.data(), frame.size())) {
+            for (size_t i = 0; i < count && written + i < expected.size(); ++i)
+                CHECK(equals(frame[i], expected[written + i]));
+
+            written += count;
+        }
+
+        CHECK(written == expected.size());
+    }
+}
+
+TEST(pattern_incremental_hashes_match_hashlittle) {
+    for (pattern_case const& c : cases()) {
+        std::vector<std::string> expected = reference::expand(c.nodes);
+
+        pattern_t pattern(c.pattern);
+        lookup3_incremental hasher;
+        uploaded_string value;
+
+        size_t written = 0;
+        while (pattern.write(value, hasher)) {
+            if (CHECK(written < expected.size())) {
+                CHECK(value.value() == expected[written]);
+                CHECK(value.get_hash() == reference::hash(expected[written]));
+            }
+
+            ++written;
+        }
+
+        CHECK(written == expected.size());
+    }
+}
+
+TEST(pattern_seek_and_write_at) {
+    for (pattern_case const& c : cases()) {
+        std::vector<std::string> expected = reference::expand(c.nodes);
+
+        pattern_t pattern(c.pattern);
+        uploaded_string value;
+
+        // Backwards, so that every seek moves the odometer back.
+        for (size_t index = expected.size(); index-- > 0;) {
+            CHECK(pattern.write_at(index, value));
+            CHECK(equals(value, expected[index]));
+
+            pattern.seek(index);
+            CHECK(pattern.next_index() == index);
+            CHECK(pattern.write(value));
+            CHECK(equals(value, expected[index]));
+
+            // The next value follows on from the sought one.
+            if (index + 1 < expected.size()) {
+                CHECK(pattern.write(value));
+                CHECK(equals(value, expected[index + 1]));
+            }
+        }
+
+        CHECK(!pattern.write_at(expected.size(), value));
+
+        pattern.seek(expected.size());
+        CHECK(!pattern.has_next());
+        CHECK(!pattern.write(value));
+    }
+}
+
+TEST(pattern_advance_matches_seek) {
+    for (pattern_case const& c : cases()) {
+        std::vector<std::string> expected = reference::expand(c.nodes);
+
+        for (uint64_t step : { 1, 2, 3, 9, 10, 11, 100 }) {
+            pattern_t pattern(c.pattern);
+            uploaded_string value;
+
+            uint64_t index = 0;
+            while (index < expected.size()) {
+                CHECK(pattern.next_index() == index);
+                CHECK(pattern.write(value));
+                CHECK(equals(value, expected[index]));
+
+                // write() moved one past index already.
+                pattern.advance(step - 1);
+                index += step;
+            }
+
+            CHECK(!pattern.has_next());
+        }
+    }
+}
+
+TEST(pattern_limit_ends_the_enumeration) {
+    for (pattern_case const& c : cases()) {
+        std::vector<std::string> expected = reference::expand(c.nodes);
+
+        pattern_t pattern(c.pattern);
+        uint64_t first = expected.size() / 3;
+        uint64_t last = expected.size() - expected.size() / 3;
+
+        pattern.limit(last);
+        pattern.seek(first);
+
+        uploaded_string value;
+        uint64_t index = first;
+        while (pattern.write(value)) {
+            if (CHECK(index < last))
+                CHECK(equals(value, expected[index]));
+
+            ++index;
+        }
+
+        CHECK(index == last);
+
+        pattern.seek(last);
+        CHECK(!pattern.has_next());
+    }
+}
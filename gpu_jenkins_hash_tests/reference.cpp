@@ -0,0 +1,45 @@
+#include "reference.hpp"
+
+#include "lookup3.hpp"
+
+#include <cstring>
+
+namespace reference {
+    uint32_t hash(std::string_view value) {
+        std::vector<uint32_t> words(value.size() / sizeof(uint32_t) + 1, 0u);
+        memcpy(words.data(), value.data(), value.size());
+
+        return hashlittle(words.data(), value.size(), 0);
+    }
+
+    std::vector<std::string> range(std::string_view alphabet, size_t min_length, size_t max_length) {
+        std::vector<std::string> values;
+        for (size_t length = min_length; length <= max_length; ++length) {
+            std::vector<std::vector<std::string>> nodes(length);
+            for (std::vector<std::string>& node : nodes)
+                for (char c : alphabet)
+                    node.emplace_back(1, c);
+
+            std::vector<std::string> strings = expand(nodes);
+            values.insert(values.end(), strings.begin(), strings.end());
+        }
+
+        return values;
+    }
+
+    std::vector<std::string> expand(std::vector<std::vector<std::string>> const& nodes) {
+        std::vector<std::string> values = { std::string() };
+        for (std::vector<std::string> const& node : nodes) {
+            std::vector<std::string> next;
+            next.reserve(values.size() * node.size());
+
+            for (std::string const& value : values)
+                for (std::string const& suffix : node)
+                    next.push_back(value + suffix);
+
+            values.swap(next);
+        }
+
+        return values;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Straightforward versions of what the code under test computes, to check it against.
+namespace reference {
+    // hashlittle() of value, from a zero-padded copy.
+    uint32_t hash(std::string_view value);
+
+    // Every string of min_length to max_length characters of alphabet, shortest first, the last
+    // character varying fastest: the values of a [...]{min,max} node.
+    std::vector<std::string> range(std::string_view alphabet, size_t min_length, size_t max_length);
+
+    // Every concatenation of one value of each node, the last node varying fastest: the values of
+    // a pattern, in the order pattern_t enumerates them.
+    std::vector<std::string> expand(std::vector<std::vector<std::string>> const& nodes);
+}
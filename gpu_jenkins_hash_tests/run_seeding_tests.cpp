@@ -0,0 +1,199 @@
+#include "test.hpp"
+#include "reference.hpp"
+
+#include "cpu_jenkins_hash.hpp"
+#include "lookup3.hpp"
+#include "lookup3_batch.hpp"
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    // Heads past a block or more, runs of one or several lengths, and runs too short to be seeded.
+    const std::vector<std::string> patterns = {
+        "interface/icons/inv_misc_(a|bb|ccc)/[a-z]{2}.blp",
+        "world/maps/azeroth/(a|bb)/[a-c]{1,3}_[num]{0,2}.adt",
+        "creature/(x|yy|zzz|wwww)/[num]{1}[a-b]{0,4}.m2",
+        "sound/music/zonemusic/(a|b)/[hex]{2}(.mp3|.ogg|.wav)",
+        "short[a-c]{0,2}",
+        "[num]{1,2}",
+    };
+
+    // Fills frames a run of values sharing a head at a time, as main() does for the CPU backend.
+    class run_source {
+    public:
+        size_t fill(uploaded_string* data, size_t capacity, std::vector<prefix_run>& runs) {
+            runs.clear();
+
+            size_t count = 0;
+            while (count < capacity && next()) {
+                prefix_run run;
+                run.begin = count;
+                run.prefix = std::string(_pattern.head());
+
+                count += _pattern.write(data + count, size_t(std::min<uint64_t>(capacity - count, _pattern.run_remaining())));
+
+                run.end = count;
+                runs.push_back(std::move(run));
+            }
+
+            memset(data + count, 0, sizeof(uploaded_string) * (capacity - count));
+            return count;
+        }
+
+        size_t produced() const { return _produced; }
+
+    private:
+        size_t _next = 0;
+        size_t _produced = 0;
+        pattern_t _pattern;
+
+        bool next() {
+            while (!_pattern.has_next()) {
+                if (_next == patterns.size())
+                    return false;
+
+                _pattern.load(patterns[_next++]);
+                _produced += size_t(_pattern.count());
+            }
+
+            return true;
+        }
+    };
+}
+
+TEST(run_seeded_kernels_match_hashlittle) {
+    std::vector<lookup3_kernel> kernels;
+    for (lookup3_kernel kernel : { lookup3_kernel::scalar, lookup3_kernel::avx2, lookup3_kernel::avx512 })
+        if (hashlittle_batch_supported(kernel))
+            kernels.push_back(kernel);
+
+    for (lookup3_kernel kernel : kernels) {
+        run_source source;
+        lookup3_run_seeder seeder;
+
+        // Frames end in the middle of runs, and chunks of them start there.
+        std::vector<uploaded_string> frame(1000);
+        std::vector<prefix_run> runs;
+
+        size_t hashed = 0;
+        while (size_t count = source.fill(frame.data(), frame.size(), runs)) {
+            seeder.reset(runs);
+            for (size_t begin = 0; begin < count; begin += 300) {
+                size_t end = std::min(count, begin + 300);
+                hashlittle_batch(frame.data() + begin, end - begin, kernel, lookup3_seeds(&seeder, begin));
+            }
+
+            for (size_t i = 0; i < count; ++i)
+                if (!CHECK(frame[i].get_hash() == reference::hash(frame[i].value())))
+                    break;
+
+            hashed += count;
+        }
+
+        CHECK(hashed == source.produced());
+    }
+}
+
+TEST(run_table_midstates_match_hashlittle) {
+    run_source source;
+    lookup3_run_table table;
+
+    std::vector<uploaded_string> frame(1000);
+    std::vector<uint32_t> entries(lookup3_run_table::required_words(frame.size()));
+    std::vector<prefix_run> runs;
+
+    size_t hashed = 0;
+    size_t resumed = 0;
+    while (size_t count = source.fill(frame.data(), frame.size(), runs)) {
+        size_t words = table.build(frame.data(), count, runs, entries.data());
+        CHECK(words <= entries.size());
+
+        // What jenkins.comp built with RUN_MIDSTATES does with each string.
+        for (size_t i = 0; i < count; ++i) {
+            std::string_view value = frame[i].value();
+
+            lookup3_state state;
+            state.a = state.b = state.c = 0xdeadbeef + uint32_t(value.size());
+            uint32_t blocks = 0;
+
+            if (uint32_t entry = frame[i].get_hash()) {
+                if (!CHECK(entry * 4 < words))
+                    break;
+
+                state.a = entries[entry * 4];
+                state.b = entries[entry * 4 + 1];
+                state.c = entries[entry * 4 + 2];
+                blocks = entries[entry * 4 + 3];
+                ++resumed;
+            }
+
+            const uint32_t* k = reinterpret_cast<const uint32_t*>(value.data()) + blocks * 3;
+            if (!CHECK(hashlittle_tail(k, value.size() - blocks * 12, state.a, state.b, state.c) == reference::hash(value)))
+                break;
+        }
+
+        hashed += count;
+    }
+
+    CHECK(hashed == source.produced());
+    CHECK(resumed > hashed / 2);
+}
+
+TEST(cpu_engine_with_runs_matches_hashlittle) {
+    JenkinsCpuHash cpu(3, 4, 1000);
+
+    run_source source;
+    std::vector<prefix_run> runs;
+    cpu.setDataProvider([&source, &runs](uploaded_string* data, size_t capacity) -> size_t {
+        return source.fill(data, capacity, runs);
+    });
+
+    cpu.setRunProvider([&runs](std::vector<prefix_run>& frameRuns) {
+        frameRuns.swap(runs);
+    });
+
+    size_t hashed = 0;
+    size_t mismatches = 0;
+    cpu.setOutputHandler([&hashed, &mismatches](uploaded_string* data, size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            if (data[i].get_hash() != reference::hash(data[i].value()))
+                ++mismatches;
+
+        hashed += count;
+    });
+
+    cpu.run();
+
+    CHECK(mismatches == 0);
+    CHECK(hashed == source.produced());
+}
+
+TEST(cpu_engine_rethrows_handler_errors) {
+    JenkinsCpuHash cpu(3, 4, 1000);
+
+    run_source source;
+    std::vector<prefix_run> runs;
+    cpu.setDataProvider([&source, &runs](uploaded_string* data, size_t capacity) -> size_t {
+        return source.fill(data, capacity, runs);
+    });
+
+    cpu.setOutputHandler([](uploaded_string*, size_t) {
+        throw std::runtime_error("output handler failed");
+    });
+
+    bool thrown = false;
+    try {
+        cpu.run();
+    }
+    catch (const std::runtime_error& e) {
+        thrown = std::string(e.what()) == "output handler failed";
+    }
+
+    CHECK(thrown);
+}
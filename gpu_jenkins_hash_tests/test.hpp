@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal test harness. TEST(name) defines a test and registers it; CHECK(condition) reports a
+// failure and lets the test go on, so that one run lists every broken case. A test that throws
+// fails as well.
+namespace test {
+    struct test_case {
+        const char* name;
+        void (*run)();
+    };
+
+    std::vector<test_case>& registry();
+
+    struct registration {
+        registration(const char* name, void (*run)()) {
+            registry().push_back({ name, run });
+        }
+    };
+
+    // Records a failure unless condition holds; returns condition.
+    bool check(bool condition, const char* expression, const char* file, int line);
+
+    // Path of a file named name in the temporary directory.
+    std::string temporary_path(std::string const& name);
+}
+
+#define TEST(name) \
+    static void name(); \
+    static test::registration name##_registration(#name, name); \
+    static void name()
+
+#define CHECK(condition) test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
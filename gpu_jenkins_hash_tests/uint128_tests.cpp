@@ -0,0 +1,113 @@
+#include "test.hpp"
+
+#include "uint128.hpp"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace {
+    const uint64_t max_64 = ~uint64_t(0);
+
+    // Little-endian 32-bit limbs of a 256-bit value.
+    using limbs_t = std::array<uint32_t, 8>;
+
+    limbs_t limbs(uint128 const& value) {
+        return { uint32_t(value.low), uint32_t(value.low >> 32), uint32_t(value.high), uint32_t(value.high >> 32), 0, 0, 0, 0 };
+    }
+
+    limbs_t reference_add(limbs_t const& lhs, limbs_t const& rhs) {
+        limbs_t sum{};
+        uint64_t carry = 0;
+        for (size_t i = 0; i < sum.size(); ++i) {
+            carry += uint64_t(lhs[i]) + rhs[i];
+            sum[i] = uint32_t(carry);
+            carry >>= 32;
+        }
+
+        return sum;
+    }
+
+    limbs_t reference_multiply(limbs_t const& lhs, limbs_t const& rhs) {
+        limbs_t product{};
+        for (size_t i = 0; i < 4; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < 4; ++j) {
+                carry += uint64_t(lhs[i]) * rhs[j] + product[i + j];
+                product[i + j] = uint32_t(carry);
+                carry >>= 32;
+            }
+
+            product[i + 4] = uint32_t(carry);
+        }
+
+        return product;
+    }
+
+    // Whether value, as returned by add() or multiply(), is the reference result, or whether both
+    // agree that it does not fit.
+    bool matches(bool fits, uint128 const& value, limbs_t const& expected) {
+        bool expected_fits = expected[4] == 0 && expected[5] == 0 && expected[6] == 0 && expected[7] == 0;
+        if (fits != expected_fits)
+            return false;
+
+        return !fits || limbs(value) == expected;
+    }
+
+    // Random values, most of them close to a power of two, where carries happen.
+    uint64_t random_64(std::mt19937_64& random) {
+        switch (random() % 4) {
+        case 0: return random();
+        case 1: return random() >> (random() % 64);
+        case 2: return max_64 >> (random() % 64);
+        default: return (uint64_t(1) << (random() % 64)) + (random() % 3) - 1;
+        }
+    }
+}
+
+TEST(uint128_add_and_multiply_match_long_arithmetic) {
+    std::mt19937_64 random(128);
+
+    for (size_t i = 0; i < 100000; ++i) {
+        uint128 lhs(random() % 3 == 0 ? 0 : random_64(random), random_64(random));
+        uint128 rhs(random() % 3 == 0 ? 0 : random_64(random), random_64(random));
+
+        uint128 sum;
+        CHECK(matches(uint128::add(lhs, rhs, sum), sum, reference_add(limbs(lhs), limbs(rhs))));
+
+        uint128 product;
+        CHECK(matches(uint128::multiply(lhs, rhs, product), product, reference_multiply(limbs(lhs), limbs(rhs))));
+
+        // The 64-bit overload never overflows.
+        uint128 full = uint128::multiply(lhs.low, rhs.low);
+        CHECK(limbs(full) == reference_multiply(limbs(uint128(lhs.low)), limbs(uint128(rhs.low))));
+    }
+}
+
+TEST(uint128_reports_overflow) {
+    const uint128 max(max_64, max_64);
+    uint128 result;
+
+    CHECK(!uint128::add(max, 1, result));
+    CHECK(!uint128::add(uint128(max_64, 0), uint128(1, 0), result));
+    CHECK(uint128::add(uint128(max_64 - 1, max_64), 1, result) && result == uint128(max_64, 0));
+
+    CHECK(!uint128::multiply(uint128(1, 0), uint128(1, 0), result));
+    CHECK(!uint128::multiply(uint128(2, 0), uint128(uint64_t(1) << 63), result));
+    CHECK(uint128::multiply(uint128(1, 0), max_64, result) && result == uint128(max_64, 0));
+    CHECK(uint128::multiply(max_64, max_64, result) && result == uint128(max_64 - 1, 1));
+}
+
+TEST(uint128_to_string) {
+    CHECK(uint128().to_string() == "0");
+    CHECK(uint128(max_64).to_string() == "18446744073709551615");
+    CHECK(uint128(1, 0).to_string() == "18446744073709551616");
+    CHECK(uint128(0x5, 0x6BC75E2D63100000).to_string() == "100000000000000000000");
+    CHECK(uint128(0x4B3B4CA85A86C47A, 0x098A224000000000).to_string() == "100000000000000000000000000000000000000");
+    CHECK(uint128(max_64, max_64).to_string() == "340282366920938463463374607431768211455");
+
+    CHECK(double(uint128(1, 0)) == 18446744073709551616.0);
+    CHECK(uint128(1, 0).fits_64() == false && uint128(max_64).fits_64());
+    CHECK(uint128(max_64) < uint128(1, 0) && !(uint128(1, 0) < uint128(1, 0)));
+}
@@ -0,0 +1,150 @@
+#include "test.hpp"
+#include "reference.hpp"
+
+#include "pattern.hpp"
+#include "pattern_descriptor.hpp"
+#include "wordlist.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+    void write_file(std::string const& path, std::string const& contents) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+    }
+
+    std::string read_file(std::string const& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::vector<std::string> words_of(wordlist const& words) {
+        std::vector<std::string> values;
+        for (size_t i = 0; i < words.size(); ++i)
+            values.emplace_back(words[i]);
+
+        return values;
+    }
+
+    std::vector<std::string> values_of(std::string const& text) {
+        pattern_t pattern(text);
+
+        std::vector<std::string> values;
+        uploaded_string value;
+        while (pattern.write(value)) {
+            CHECK(value.get_cpu_hash() == reference::hash(value.value()));
+            values.emplace_back(value.value());
+        }
+
+        return values;
+    }
+}
+
+TEST(wordlist_binary_round_trip) {
+    const std::string text = test::temporary_path("words.txt");
+    const std::string binary = test::temporary_path("words.bin");
+    const std::string again = test::temporary_path("words_again.bin");
+
+    // Empty lines and lines longer than an uploaded_string are skipped; CRLF line ends are fine.
+    write_file(text, "foo\nBar/baz\r\n\nqu/ux\n" + std::string(uploaded_string::max_length + 1, 'x') + "\nab\nwordlist\nz\nyz");
+
+    {
+        std::shared_ptr<const wordlist> words = wordlist::open(text);
+        CHECK((words_of(*words) == std::vector<std::string>{ "FOO", "BAR\\BAZ", "QU\\UX", "AB", "WORDLIST", "Z", "YZ" }));
+        CHECK(words->shortest() == 1);
+        CHECK(words->longest() == 8);
+
+        // The file itself is left alone.
+        CHECK(read_file(text).substr(0, 4) == "foo\n");
+    }
+
+    wordlist::convert(text, binary);
+
+    {
+        // Grouped by length, in order within each length.
+        std::shared_ptr<const wordlist> words = wordlist::open(binary);
+        CHECK((words_of(*words) == std::vector<std::string>{ "Z", "AB", "YZ", "FOO", "QU\\UX", "BAR\\BAZ", "WORDLIST" }));
+        CHECK(words->shortest() == 1);
+        CHECK(words->longest() == 8);
+
+        // Words start on 4-byte boundaries and are followed by zeros, like uploaded_string.
+        for (size_t i = 0; i < words->size(); ++i) {
+            std::string_view word = (*words)[i];
+            CHECK(reinterpret_cast<uintptr_t>(word.data()) % sizeof(uint32_t) == 0);
+
+            for (size_t j = word.size(); j % sizeof(uint32_t) != 0; ++j)
+                CHECK(word.data()[j] == '\0');
+        }
+
+        // Converting a binary wordlist gives the same file.
+        wordlist::convert(binary, again);
+        CHECK(read_file(again) == read_file(binary));
+    }
+
+    // Dictionary nodes enumerate either format the same way.
+    std::vector<std::string> from_text = values_of("{" + text + "}.blp");
+    std::vector<std::string> from_binary = values_of("{" + binary + "}.blp");
+    CHECK((from_text == std::vector<std::string>{ "FOO.BLP", "BAR\\BAZ.BLP", "QU\\UX.BLP", "AB.BLP", "WORDLIST.BLP", "Z.BLP", "YZ.BLP" }));
+    CHECK((from_binary == std::vector<std::string>{ "Z.BLP", "AB.BLP", "YZ.BLP", "FOO.BLP", "QU\\UX.BLP", "BAR\\BAZ.BLP", "WORDLIST.BLP" }));
+
+    std::remove(text.c_str());
+    std::remove(binary.c_str());
+    std::remove(again.c_str());
+}
+
+TEST(wordlist_rejects_corrupt_binary_files) {
+    const std::string text = test::temporary_path("corrupt.txt");
+    const std::string binary = test::temporary_path("corrupt.bin");
+
+    write_file(text, "a\nbb\nccc\n");
+    wordlist::convert(text, binary);
+
+    // Truncated, then with a word count that does not add up.
+    std::string contents = read_file(binary);
+    for (std::string corrupt : { contents.substr(0, contents.size() - 4), contents.substr(0, 16) + std::string(8, '\x7f') + contents.substr(24) }) {
+        write_file(binary, corrupt);
+
+        bool thrown = false;
+        try {
+            wordlist::open(binary);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+
+        CHECK(thrown);
+    }
+
+    std::remove(text.c_str());
+    std::remove(binary.c_str());
+}
+
+TEST(pattern_descriptor_rejects_wordlists_past_the_device_limit) {
+    const std::string path = test::temporary_path("descriptor_words.txt");
+
+    // Each word takes two table words and three words of characters.
+    for (size_t count : { size_t(100), pattern_descriptor::max_words / 4 }) {
+        std::string words;
+        for (size_t i = 0; i < count; ++i)
+            words += "w" + std::to_string(10000000 + i) + "\n";
+        write_file(path, words);
+
+        bool thrown = false;
+        try {
+            pattern_descriptor descriptor("[a-b]{" + path + "}");
+            CHECK(descriptor.words().size() <= pattern_descriptor::max_words);
+            CHECK(descriptor.count() == 2 * count);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+
+        CHECK(thrown == (count != 100));
+    }
+
+    std::remove(path.c_str());
+}